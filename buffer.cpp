@@ -0,0 +1,52 @@
+#include "buffer.h"
+
+#include "fd.h"
+
+
+void * _remap_buffer(void *ptr, size_t &mapped_size, size_t keep, size_t new_size, bool huge_pages) {
+	static const size_t page_size = ::sysconf(_SC_PAGESIZE);
+	size_t new_mapped_size = (new_size + page_size - 1) & ~(page_size - 1);
+	if (new_size == 0) {
+		if (mapped_size) {
+			posix::munmap(ptr, mapped_size);
+		}
+		else {
+			std::free(ptr);
+		}
+		mapped_size = 0;
+		return nullptr;
+	}
+	if (!mapped_size) {
+		void *new_ptr = posix::mmap(nullptr, new_mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (huge_pages) {
+			::madvise(new_ptr, new_mapped_size, MADV_HUGEPAGE);
+		}
+		if (ptr) {
+			std::memcpy(new_ptr, ptr, keep);
+			std::free(ptr);
+		}
+		mapped_size = new_mapped_size;
+		return new_ptr;
+	}
+	if (new_mapped_size <= mapped_size) {
+		// keep the address space for regrowth, but not the memory behind it
+		if (new_mapped_size < mapped_size) {
+			::madvise(static_cast<std::byte *>(ptr) + new_mapped_size, mapped_size - new_mapped_size, MADV_DONTNEED);
+		}
+		return ptr;
+	}
+#ifdef __linux__
+	ptr = linux::mremap(ptr, mapped_size, new_mapped_size, MREMAP_MAYMOVE);
+	if (huge_pages) {
+		::madvise(ptr, new_mapped_size, MADV_HUGEPAGE);
+	}
+	mapped_size = new_mapped_size;
+	return ptr;
+#else
+	void *new_ptr = posix::mmap(nullptr, new_mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	std::memcpy(new_ptr, ptr, keep);
+	posix::munmap(ptr, mapped_size);
+	mapped_size = new_mapped_size;
+	return new_ptr;
+#endif
+}
@@ -1,11 +1,16 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <cstdlib>
 #include <cstring>
 #include <new>
+#include <utility>
+
+#include <sys/mman.h>
 
 #include "bit.h"
+#include "bufferpool.h"
 #include "compiler.h"
 #include "span.h"
 
@@ -58,26 +63,70 @@ template <size_t N>
 using StaticBuffer = BasicStaticBuffer<std::byte, N>;
 
 
+// Grows, shrinks or frees a buffer of new_size bytes held in an anonymous memory mapping of mapped_size
+// bytes, or moves a malloc'd buffer (with mapped_size zero) into one, preserving its first keep bytes.
+// Growth uses mremap, so it needs no copy; shrinking keeps the mapping but returns the pages past the
+// new end to the system. Returns the buffer's new address and updates mapped_size.
+_nodiscard void * _remap_buffer(void *ptr, size_t &mapped_size, size_t keep, size_t new_size, bool huge_pages);
+
+
 template <typename T>
 struct BasicDynamicBuffer : BasicBufferView<T> {
+	// beyond this size, buffers not from a pool are held in their own memory mapping
+#ifdef __linux__
+	static constexpr size_t mmap_threshold = size_t(32) << 20;
+#else
+	static constexpr size_t mmap_threshold = SIZE_MAX;
+#endif
+	BufferPool *pool = nullptr; // if not null, the buffer's memory comes from and returns to this pool
+	size_t mapped_size = 0; // if not zero, the buffer is in a memory mapping of this size
+	bool huge_pages = false; // whether to advise the kernel to back a mapping with transparent huge pages
 	BasicDynamicBuffer() noexcept = default;
-	explicit BasicDynamicBuffer(size_t size) : BasicBufferView<T>(static_cast<T *>(size == 0 ? nullptr : sizeof(T) == 1 ? std::malloc(size) : reallocarray(nullptr, size, sizeof(T))), size) { if (_unlikely(!this->bptr && size)) throw std::bad_alloc(); }
-	BasicDynamicBuffer(BasicDynamicBuffer &&move) noexcept : BasicBufferView<T>(std::move(move)) { move.eptr = move.pptr = move.gptr = move.bptr = nullptr; }
+	explicit BasicDynamicBuffer(size_t size) : BasicDynamicBuffer(size, false) { }
+	// huge_pages applies from the first mapping, if size is large enough to need one
+	BasicDynamicBuffer(size_t size, bool huge_pages) : huge_pages(huge_pages) {
+		if (size >= mmap_threshold / sizeof(T)) {
+			this->bptr = static_cast<T *>(_remap_buffer(nullptr, mapped_size, 0, size * sizeof(T), huge_pages));
+		}
+		else if (_unlikely(!(this->bptr = static_cast<T *>(size == 0 ? nullptr : sizeof(T) == 1 ? std::malloc(size) : reallocarray(nullptr, size, sizeof(T)))) && size)) {
+			throw std::bad_alloc();
+		}
+		this->eptr = (this->pptr = this->gptr = this->bptr) + size;
+	}
+	BasicDynamicBuffer(size_t size, BufferPool &pool) : BasicBufferView<T>(static_cast<T *>(size == 0 ? nullptr : pool.allocate(size * sizeof(T))), pooled_size(size)), pool(&pool) { }
+	BasicDynamicBuffer(BasicDynamicBuffer &&move) noexcept : BasicBufferView<T>(std::move(move)), pool(move.pool), mapped_size(std::exchange(move.mapped_size, 0)), huge_pages(move.huge_pages) { move.eptr = move.pptr = move.gptr = move.bptr = nullptr; }
 	BasicDynamicBuffer & operator=(BasicDynamicBuffer &&move) noexcept { return this->swap(move), *this; }
-	~BasicDynamicBuffer() noexcept { std::free(this->bptr); }
-	void swap(BasicDynamicBuffer &other) noexcept { using std::swap; swap(this->bptr, other.bptr), swap(this->gptr, other.gptr), swap(this->pptr, other.pptr), swap(this->eptr, other.eptr); }
+	~BasicDynamicBuffer() noexcept { this->deallocate(); }
+	void swap(BasicDynamicBuffer &other) noexcept { using std::swap; swap(this->bptr, other.bptr), swap(this->gptr, other.gptr), swap(this->pptr, other.pptr), swap(this->eptr, other.eptr), swap(pool, other.pool), swap(mapped_size, other.mapped_size), swap(huge_pages, other.huge_pages); }
 	friend void swap(BasicDynamicBuffer &lhs, BasicDynamicBuffer &rhs) noexcept { lhs.swap(rhs); }
 	constexpr _const operator BasicDynamicBuffer<const T> & () noexcept { return reinterpret_cast<BasicDynamicBuffer<const T> &>(*this); }
 	constexpr _const operator const BasicDynamicBuffer<const T> & () const noexcept { return reinterpret_cast<const BasicDynamicBuffer<const T> &>(*this); }
 	void resize(size_t size) {
-		T *new_bptr = static_cast<T *>(sizeof(T) == 1 ? std::realloc(this->bptr, size) : reallocarray(this->bptr, size, sizeof(T)));
-		if (_unlikely(!new_bptr && size)) {
+		T *new_bptr;
+		if (pool) {
+			if ((size = pooled_size(size)) == this->size()) {
+				return;
+			}
+			if ((new_bptr = size == 0 ? nullptr : static_cast<T *>(pool->allocate(size * sizeof(T)))) && this->bptr) {
+				std::memcpy(new_bptr, this->bptr, std::min(this->ppos(), size) * sizeof(T));
+			}
+			pool->deallocate(this->bptr, this->size() * sizeof(T));
+		}
+		else if (mapped_size || size >= mmap_threshold / sizeof(T)) {
+			new_bptr = static_cast<T *>(_remap_buffer(this->bptr, mapped_size, std::min(this->ppos(), size) * sizeof(T), size * sizeof(T), huge_pages));
+		}
+		else if (_unlikely(!(new_bptr = static_cast<T *>(sizeof(T) == 1 ? std::realloc(this->bptr, size) : reallocarray(this->bptr, size, sizeof(T)))) && size)) {
 			throw std::bad_alloc();
 		}
 		size_t gpos = this->gpos(), ppos = this->ppos();
 		this->eptr = (this->bptr = new_bptr) + size;
 		this->gpos(gpos), this->ppos(ppos);
 	}
+	// frees the buffer's memory, or lends it back to the pool, leaving the buffer empty with no capacity
+	void release() noexcept {
+		this->deallocate();
+		this->eptr = this->pptr = this->gptr = this->bptr = nullptr, mapped_size = 0;
+	}
 	void ensure(size_t min_size) {
 		if (this->size() < min_size) {
 			this->resize(std::bit_ceil(min_size));
@@ -98,6 +147,18 @@ struct BasicDynamicBuffer : BasicBufferView<T> {
 private:
 	BasicDynamicBuffer(const BasicDynamicBuffer &) = delete;
 	BasicDynamicBuffer & operator=(const BasicDynamicBuffer &) = delete;
+	static constexpr size_t _const pooled_size(size_t size) noexcept { return size == 0 ? 0 : BufferPool::round_size(size * sizeof(T)) / sizeof(T); }
+	void deallocate() noexcept {
+		if (pool) {
+			pool->deallocate(this->bptr, this->size() * sizeof(T));
+		}
+		else if (mapped_size) {
+			::munmap(this->bptr, mapped_size);
+		}
+		else {
+			std::free(this->bptr);
+		}
+	}
 #if !__GLIBC__ || !__GLIBC_PREREQ(2, 26)
 	static inline void * reallocarray(void *ptr, size_t nmemb, size_t size) noexcept {
 		return size == 0 || nmemb <= SIZE_MAX / size ? std::realloc(ptr, nmemb * size) : nullptr;
@@ -0,0 +1,122 @@
+#include "bufferchain.h"
+
+#include <algorithm>
+
+
+struct msghdr BufferChain::msghdr() const noexcept {
+	struct msghdr message { };
+	auto iov = this->iovecs();
+	message.msg_iov = const_cast<struct iovec *>(iov.data());
+	message.msg_iovlen = std::min<size_t>(iov.size(), IOV_MAX);
+	return message;
+}
+
+void BufferChain::append(DynamicBuffer &&buffer) {
+	if (!buffer.empty()) {
+		ConstBufferPointer segment { buffer.gptr, buffer.grem() };
+		this->insert(segments.size(), segment, std::make_shared<DynamicBuffer>(std::move(buffer)));
+	}
+}
+
+void BufferChain::append(BufferChain &&other) {
+	segments.insert(segments.end(), other.segments.begin() + other.first, other.segments.end());
+	owners.insert(owners.end(), std::make_move_iterator(other.owners.begin() + other.first), std::make_move_iterator(other.owners.end()));
+	total += other.total;
+	other.clear();
+}
+
+void BufferChain::append_copy(const void *buf, size_t n) {
+	if (n > 0) {
+		ConstBufferPointer segment = this->copy(buf, n);
+		if (first < segments.size() && owners.back() == chunk && static_cast<const std::byte *>(segments.back().ptr) + segments.back().size == segment.ptr) {
+			// follows on from the previous copy
+			segments.back().size += n, total += n;
+		}
+		else {
+			this->insert(segments.size(), segment, chunk);
+		}
+	}
+}
+
+void BufferChain::prepend(DynamicBuffer &&buffer) {
+	if (!buffer.empty()) {
+		ConstBufferPointer segment { buffer.gptr, buffer.grem() };
+		this->insert(first, segment, std::make_shared<DynamicBuffer>(std::move(buffer)));
+	}
+}
+
+void BufferChain::prepend_copy(const void *buf, size_t n) {
+	if (n > 0) {
+		ConstBufferPointer segment = this->copy(buf, n);
+		this->insert(first, segment, chunk);
+	}
+}
+
+void BufferChain::consume(size_t n) noexcept {
+	total -= n = std::min(n, total);
+	for (; n > 0; ++first) {
+		ConstBufferPointer &segment = segments[first];
+		if (n < segment.size) {
+			segment.ptr = static_cast<const std::byte *>(segment.ptr) + n, segment.size -= n;
+			break;
+		}
+		n -= segment.size;
+		owners[first].reset();
+	}
+	if (first == segments.size()) {
+		segments.clear(), owners.clear(), first = 0;
+	}
+}
+
+BufferChain BufferChain::split(size_t n) {
+	BufferChain front;
+	size_t end = first, whole = 0;
+	for (n = std::min(n, total); end < segments.size() && whole + segments[end].size <= n; ++end) {
+		whole += segments[end].size;
+	}
+	front.segments.assign(segments.begin() + first, segments.begin() + end);
+	front.owners.assign(std::make_move_iterator(owners.begin() + first), std::make_move_iterator(owners.begin() + end));
+	if (whole < n) {
+		// the split falls inside this segment, so both halves share its owner
+		ConstBufferPointer &segment = segments[end];
+		size_t part = n - whole;
+		front.segments.push_back({ segment.ptr, part });
+		front.owners.push_back(owners[end]);
+		segment.ptr = static_cast<const std::byte *>(segment.ptr) + part, segment.size -= part;
+	}
+	front.total = n;
+	first = end, total -= n;
+	if (first == segments.size()) {
+		segments.clear(), owners.clear(), first = 0;
+	}
+	return front;
+}
+
+void BufferChain::insert(size_t index, ConstBufferPointer segment, std::shared_ptr<DynamicBuffer> owner) {
+	if (segment.size == 0) {
+		return;
+	}
+	if (index == first && first > 0) {
+		// reuse a consumed slot rather than shifting everything along
+		segments[--first] = segment, owners[first] = std::move(owner);
+	}
+	else {
+		if (first > 0 && first * 2 >= segments.size()) {
+			segments.erase(segments.begin(), segments.begin() + first);
+			owners.erase(owners.begin(), owners.begin() + first);
+			index -= first, first = 0;
+		}
+		segments.insert(segments.begin() + index, segment);
+		owners.insert(owners.begin() + index, std::move(owner));
+	}
+	total += segment.size;
+}
+
+ConstBufferPointer BufferChain::copy(const void *buf, size_t n) {
+	if (!chunk || chunk->prem() < n) {
+		chunk = std::make_shared<DynamicBuffer>(std::max(n, copy_chunk_size));
+	}
+	ConstBufferPointer segment { chunk->pptr, n };
+	std::memcpy(chunk->pptr, buf, n), chunk->pbump(n);
+	return segment;
+}
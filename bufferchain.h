@@ -0,0 +1,70 @@
+#pragma once
+
+#include <climits>
+#include <memory>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "buffer.h"
+#include "compiler.h"
+#include "io.h"
+
+
+// A message assembled from a sequence of segments, without concatenating them. Borrowed segments refer to
+// memory that the caller must keep alive until they are consumed; owned segments hold their memory, which
+// may be a moved-in DynamicBuffer or a copy, with small copies packed together into shared chunks. The
+// segments can be handed as they are to writev, sendmsg or Writable::write.
+class BufferChain {
+
+public:
+	static constexpr size_t copy_chunk_size = 4096;
+
+private:
+	std::vector<ConstBufferPointer> segments; // those before first have been consumed
+	std::vector<std::shared_ptr<DynamicBuffer>> owners; // in parallel with segments; null where borrowed
+	std::shared_ptr<DynamicBuffer> chunk; // where copies go while it has room
+	size_t first, total;
+
+public:
+	BufferChain() noexcept : first(), total() { }
+
+public:
+	size_t _pure size() const noexcept { return total; }
+	bool _pure empty() const noexcept { return total == 0; }
+
+	std::span<const ConstBufferPointer> _pure buffers() const noexcept { return { segments.data() + first, segments.size() - first }; }
+	std::span<const struct iovec> _pure iovecs() const noexcept { return { reinterpret_cast<const struct iovec *>(segments.data() + first), segments.size() - first }; }
+	// a message header for sendmsg, with no address or control data
+	struct msghdr _pure msghdr() const noexcept;
+
+	void append(const void *buf, size_t n) { this->insert(segments.size(), { buf, n }, nullptr); }
+	void append(DynamicBuffer &&buffer);
+	void append(BufferChain &&other);
+	void append_copy(const void *buf, size_t n);
+
+	void prepend(const void *buf, size_t n) { this->insert(first, { buf, n }, nullptr); }
+	void prepend(DynamicBuffer &&buffer);
+	void prepend_copy(const void *buf, size_t n);
+
+	// discards n bytes from the front, as after they have been written
+	void consume(size_t n) noexcept;
+	// removes the first n bytes and returns them as a chain of their own
+	_nodiscard BufferChain split(size_t n);
+	void clear() noexcept { segments.clear(), owners.clear(), chunk.reset(), first = total = 0; }
+
+	// writes as much of the chain as output will take in one call, and consumes what it took
+	template <typename Output>
+	size_t write_to(Output &output) {
+		auto bufs = this->buffers();
+		size_t n = output.write(bufs.first(std::min<size_t>(bufs.size(), IOV_MAX)));
+		this->consume(n);
+		return n;
+	}
+
+private:
+	void insert(size_t index, ConstBufferPointer segment, std::shared_ptr<DynamicBuffer> owner);
+	ConstBufferPointer copy(const void *buf, size_t n);
+
+};
@@ -0,0 +1,299 @@
+#include "bufferpool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <unordered_set>
+#include <utility>
+
+#include <sys/mman.h>
+
+#include "bit.h"
+
+
+// the generations of the pools that are still alive
+static mutex_t live_pools_mutex;
+static std::unordered_set<uint64_t> live_pools;
+static std::atomic<uint64_t> next_generation;
+
+
+class _BufferPoolThreadCache {
+
+public:
+	struct Entry {
+		BufferPool *pool;
+		uint64_t generation;
+		bool huge_pages;
+		BufferPool::Node *heads[BufferPool::classes];
+		unsigned counts[BufferPool::classes];
+	};
+
+private:
+	std::array<Entry, 4> entries;
+
+public:
+	_BufferPoolThreadCache() noexcept : entries() { }
+
+	~_BufferPoolThreadCache() {
+		std::lock_guard<mutex_t> lock(live_pools_mutex);
+		for (auto &entry : entries) {
+			if (entry.pool) {
+				live_pools.count(entry.generation) ? flush(entry) : drop(entry);
+			}
+		}
+	}
+
+public:
+	// a thread that uses more pools than we have entries for goes straight to the shared lists of the rest
+	Entry * find(BufferPool *pool, bool claim) noexcept {
+		Entry *vacant = nullptr;
+		for (auto &entry : entries) {
+			if (entry.pool == pool) {
+				if (_likely(entry.generation == pool->generation)) {
+					return &entry;
+				}
+				// left behind by a destroyed pool that had the same address
+				drop(entry);
+			}
+			if (!entry.pool && !vacant) {
+				vacant = &entry;
+			}
+		}
+		if (!claim) {
+			return nullptr;
+		}
+		if (!vacant) {
+			vacant = this->reclaim();
+		}
+		if (vacant) {
+			vacant->pool = pool, vacant->generation = pool->generation, vacant->huge_pages = pool->huge_pages;
+		}
+		return vacant;
+	}
+
+	static void flush(Entry &entry) noexcept {
+		for (unsigned c = 0; c < BufferPool::classes; ++c) {
+			if (BufferPool::Node *head = entry.heads[c]) {
+				BufferPool::Node *tail = head;
+				while (tail->next) {
+					tail = tail->next;
+				}
+				entry.pool->deallocate_shared(c, head, tail);
+			}
+		}
+		entry = { };
+	}
+
+private:
+	// the buffers of a destroyed pool can still be freed if they came from the heap; slabs are already gone
+	static void drop(Entry &entry) noexcept {
+		if (!entry.huge_pages) {
+			for (unsigned c = 0; c < BufferPool::classes; ++c) {
+				for (BufferPool::Node *node = entry.heads[c]; node;) {
+					std::free(std::exchange(node, node->next));
+				}
+			}
+		}
+		entry = { };
+	}
+
+	// drops the entries of pools that have been destroyed, and returns the first that is then vacant
+	Entry * reclaim() noexcept {
+		Entry *vacant = nullptr;
+		std::lock_guard<mutex_t> lock(live_pools_mutex);
+		for (auto &entry : entries) {
+			if (!live_pools.count(entry.generation)) {
+				drop(entry);
+				if (!vacant) {
+					vacant = &entry;
+				}
+			}
+		}
+		return vacant;
+	}
+
+};
+
+static thread_local _BufferPoolThreadCache thread_cache;
+
+
+BufferPool::BufferPool(bool huge_pages, unsigned thread_cache_limit) : generation(next_generation.fetch_add(1, std::memory_order_relaxed) + 1), huge_pages(huge_pages), thread_cache_limit(thread_cache_limit), shared(), in_use(), high_water(), cached(), reserved() {
+	std::lock_guard<mutex_t> lock(live_pools_mutex);
+	live_pools.insert(generation);
+}
+
+BufferPool::~BufferPool() {
+	{
+		// a thread that exits from now on drops its cached buffers instead of flushing them to us
+		std::lock_guard<mutex_t> lock(live_pools_mutex);
+		live_pools.erase(generation);
+	}
+	if (auto entry = thread_cache.find(this, false)) {
+		_BufferPoolThreadCache::flush(*entry);
+	}
+	this->trim();
+	for (auto [addr, len] : slabs) {
+		::munmap(addr, len);
+	}
+}
+
+void * BufferPool::allocate(size_t size) {
+	size_t rounded = round_size(size);
+	if (rounded > max_class_size) {
+		void *ptr = this->allocate_system(rounded);
+		this->add_in_use(rounded);
+		return ptr;
+	}
+	unsigned c = class_of(rounded);
+	void *ptr;
+	if (auto entry = thread_cache_limit ? thread_cache.find(this, true) : nullptr; entry && entry->heads[c]) {
+		Node *node = entry->heads[c];
+		entry->heads[c] = node->next, --entry->counts[c];
+		cached.fetch_sub(rounded, std::memory_order_relaxed);
+		ptr = node;
+	}
+	else {
+		ptr = this->allocate_shared(c);
+	}
+	this->add_in_use(rounded);
+	return ptr;
+}
+
+void BufferPool::deallocate(void *ptr, size_t size) noexcept {
+	if (!ptr) {
+		return;
+	}
+	size_t rounded = round_size(size);
+	in_use.fetch_sub(rounded, std::memory_order_relaxed);
+	if (rounded > max_class_size) {
+		return this->deallocate_system(ptr, rounded);
+	}
+	unsigned c = class_of(rounded);
+	Node *node = static_cast<Node *>(ptr);
+	cached.fetch_add(rounded, std::memory_order_relaxed);
+	// with no thread cache, or none to spare, go straight to the shared list
+	auto entry = thread_cache_limit ? thread_cache.find(this, true) : nullptr;
+	if (!entry) {
+		node->next = nullptr;
+		return this->deallocate_shared(c, node, node);
+	}
+	node->next = entry->heads[c], entry->heads[c] = node;
+	if (++entry->counts[c] > thread_cache_limit) {
+		// spill the older half, keeping the most recently used buffers, which are likeliest to be in cache
+		Node *tail = node;
+		for (unsigned i = 1; i < (thread_cache_limit + 1) / 2; ++i) {
+			tail = tail->next;
+		}
+		Node *spill = tail->next, *spill_tail = spill;
+		size_t n = 1;
+		while (spill_tail->next) {
+			spill_tail = spill_tail->next, ++n;
+		}
+		tail->next = nullptr, entry->counts[c] -= static_cast<unsigned>(n);
+		this->deallocate_shared(c, spill, spill_tail);
+	}
+}
+
+void BufferPool::trim() noexcept {
+	if (auto entry = thread_cache.find(this, false)) {
+		_BufferPoolThreadCache::flush(*entry);
+	}
+	if (huge_pages) {
+		return;
+	}
+	for (unsigned c = 0; c < classes; ++c) {
+		Node *head;
+		{
+			std::lock_guard<mutex_t> lock(shared[c].mutex);
+			head = std::exchange(shared[c].head, nullptr);
+		}
+		size_t size = min_class_size << c, n = 0;
+		while (head) {
+			std::free(std::exchange(head, head->next)), ++n;
+		}
+		cached.fetch_sub(n * size, std::memory_order_relaxed);
+		reserved.fetch_sub(n * size, std::memory_order_relaxed);
+	}
+}
+
+BufferPool::Stats BufferPool::stats() const noexcept {
+	return { in_use.load(std::memory_order_relaxed), high_water.load(std::memory_order_relaxed), cached.load(std::memory_order_relaxed), reserved.load(std::memory_order_relaxed) };
+}
+
+unsigned BufferPool::class_of(size_t size) noexcept {
+	return static_cast<unsigned>(std::bit_width(size - 1)) - min_class_bits;
+}
+
+void * BufferPool::allocate_shared(unsigned c) {
+	size_t size = min_class_size << c;
+	Shared &s = shared[c];
+	{
+		std::lock_guard<mutex_t> lock(s.mutex);
+		if (Node *node = s.head) {
+			// take a few more for this thread's list while we hold the lock
+			s.head = node->next;
+			if (auto entry = thread_cache_limit ? thread_cache.find(this, true) : nullptr) {
+				unsigned n = 0;
+				for (Node *next; n < thread_cache_limit / 2 && (next = s.head); ++n) {
+					s.head = next->next, next->next = entry->heads[c], entry->heads[c] = next;
+				}
+				entry->counts[c] += n;
+			}
+			cached.fetch_sub(size, std::memory_order_relaxed);
+			return node;
+		}
+		if (huge_pages) {
+			if (s.slab_next == s.slab_end) {
+				size_t slab_size = std::max(size, huge_page_size);
+				s.slab_next = static_cast<std::byte *>(this->allocate_system(slab_size));
+				s.slab_end = s.slab_next + slab_size;
+				std::lock_guard<mutex_t> slabs_lock(slabs_mutex);
+				slabs.emplace_back(s.slab_next, slab_size);
+			}
+			void *ptr = s.slab_next;
+			s.slab_next += size;
+			return ptr;
+		}
+	}
+	return this->allocate_system(size);
+}
+
+void BufferPool::deallocate_shared(unsigned c, Node *head, Node *tail) noexcept {
+	std::lock_guard<mutex_t> lock(shared[c].mutex);
+	tail->next = shared[c].head, shared[c].head = head;
+}
+
+void * BufferPool::allocate_system(size_t size) {
+	void *ptr;
+	if (huge_pages) {
+		// over-allocate so as to be able to align to a huge page, then give back the excess
+		std::byte *addr = static_cast<std::byte *>(::mmap(nullptr, size + huge_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+		if (_unlikely(addr == MAP_FAILED)) {
+			throw std::bad_alloc();
+		}
+		std::byte *aligned = reinterpret_cast<std::byte *>((reinterpret_cast<uintptr_t>(addr) + huge_page_size - 1) & ~(huge_page_size - 1));
+		if (aligned > addr) {
+			::munmap(addr, aligned - addr);
+		}
+		::munmap(aligned + size, addr + huge_page_size - aligned);
+		::madvise(aligned, size, MADV_HUGEPAGE);
+		ptr = aligned;
+	}
+	else if (_unlikely(!(ptr = std::aligned_alloc(min_class_size, size)))) {
+		throw std::bad_alloc();
+	}
+	reserved.fetch_add(size, std::memory_order_relaxed);
+	return ptr;
+}
+
+void BufferPool::deallocate_system(void *ptr, size_t size) noexcept {
+	huge_pages ? static_cast<void>(::munmap(ptr, size)) : std::free(ptr);
+	reserved.fetch_sub(size, std::memory_order_relaxed);
+}
+
+void BufferPool::add_in_use(size_t size) noexcept {
+	size_t v = in_use.fetch_add(size, std::memory_order_relaxed) + size;
+	for (size_t hw = high_water.load(std::memory_order_relaxed); v > hw && !high_water.compare_exchange_weak(hw, v, std::memory_order_relaxed););
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "compiler.h"
+#include "sync.h"
+
+
+// Recycles I/O buffers in power-of-two size classes from 4 KiB to 1 MiB. Each thread keeps a short free
+// list per class, so allocating and freeing on the same thread takes no lock; lists that overflow spill
+// into shared lists, which threads with empty lists draw from. Larger sizes bypass the lists. With
+// huge_pages, buffers are carved from 2 MiB slabs advised for transparent huge pages, which are kept until
+// the pool is destroyed. Each pool has a unique generation, so that when a pool is destroyed while other
+// threads still cache its buffers, their caches can tell its entries from those of a later pool at the
+// same address, and drop them rather than flush them into a dead pool.
+class BufferPool {
+	friend class _BufferPoolThreadCache;
+
+public:
+	static constexpr unsigned min_class_bits = 12, classes = 9;
+	static constexpr size_t min_class_size = size_t(1) << min_class_bits, max_class_size = min_class_size << (classes - 1);
+	static constexpr size_t huge_page_size = size_t(2) << 20;
+
+	struct Stats {
+		size_t in_use; // bytes allocated to callers
+		size_t high_water; // the greatest in_use has been
+		size_t cached; // bytes held in free lists
+		size_t reserved; // bytes obtained from the system and not yet returned to it
+	};
+
+private:
+	struct Node {
+		Node *next;
+	};
+
+	struct alignas(64) Shared {
+		mutex_t mutex;
+		Node *head;
+		std::byte *slab_next, *slab_end;
+	};
+
+private:
+	const uint64_t generation;
+	const bool huge_pages;
+	const unsigned thread_cache_limit;
+	std::array<Shared, classes> shared;
+	alignas(64) std::atomic<size_t> in_use, high_water, cached, reserved;
+	mutex_t slabs_mutex;
+	std::vector<std::pair<void *, size_t>> slabs;
+
+public:
+	// thread_cache_limit is the length of each thread's list per class; zero gives threads no lists at all
+	explicit BufferPool(bool huge_pages = false, unsigned thread_cache_limit = 8);
+	~BufferPool();
+
+private:
+	BufferPool(const BufferPool &) = delete;
+	BufferPool & operator=(const BufferPool &) = delete;
+
+public:
+	// the capacity of the buffer that allocate(size) would return
+	static constexpr size_t _const round_size(size_t size) noexcept {
+		if (size > max_class_size) {
+			return (size + min_class_size - 1) & ~(min_class_size - 1);
+		}
+		size_t rounded = min_class_size;
+		while (rounded < size) {
+			rounded <<= 1;
+		}
+		return rounded;
+	}
+
+	// returns a page-aligned buffer of round_size(size) bytes
+	_nodiscard void * allocate(size_t size);
+	// size must be the size passed to allocate, or its round_size
+	void deallocate(void *ptr, size_t size) noexcept;
+
+	// returns the memory in the calling thread's and the shared free lists to the system; call when idle
+	void trim() noexcept;
+
+	_nodiscard Stats stats() const noexcept;
+
+private:
+	static unsigned _const class_of(size_t size) noexcept;
+
+	void * allocate_shared(unsigned c);
+	void deallocate_shared(unsigned c, Node *head, Node *tail) noexcept;
+	void * allocate_system(size_t size);
+	void deallocate_system(void *ptr, size_t size) noexcept;
+	void add_in_use(size_t size) noexcept;
+
+};
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <functional>
 #include <list>
 #include <mutex>
 
+#include "sync.h"
+
 
 template <typename... Args>
 class Callbacks {
@@ -29,7 +32,7 @@ public:
 			}
 		}
 		void swap(CallbackRegistration &other) noexcept { using std::swap; swap(callbacks_ptr, other.callbacks_ptr), swap(callback_itr, other.callback_itr); }
-		friend void swap(CallbackRegistration &lhs, CallbackRegistration &rhs) noexcept { lhs.swap(rhs)); }
+		friend void swap(CallbackRegistration &lhs, CallbackRegistration &rhs) noexcept { lhs.swap(rhs); }
 	private:
 		explicit CallbackRegistration(Callbacks *callbacks_ptr, callback_itr_t callback_itr) noexcept : callbacks_ptr(callbacks_ptr), callback_itr(callback_itr) { }
 		CallbackRegistration(const CallbackRegistration &) = delete;
@@ -37,18 +40,18 @@ public:
 	};
 
 private:
-	std::mutex mutex;
+	mutex_t mutex;
 	std::list<callback_t> callbacks;
 
 public:
 	CallbackRegistration add_callback(callback_t &&callback) {
-		std::lock_guard<std::mutex> lock(mutex);
+		std::lock_guard<mutex_t> lock(mutex);
 		return CallbackRegistration(this, callbacks.emplace(callbacks.end(), std::move(callback)));
 	}
 
 protected:
 	void do_callbacks(Args&&... args) {
-		std::lock_guard<std::mutex> lock(mutex);
+		std::lock_guard<mutex_t> lock(mutex);
 		for (auto &callback : callbacks) {
 			callback(std::forward<Args>(args)...);
 		}
@@ -56,7 +59,7 @@ protected:
 
 private:
 	void remove_callback(callback_itr_t callback_itr) {
-		std::lock_guard<std::mutex> lock(mutex);
+		std::lock_guard<mutex_t> lock(mutex);
 		callbacks.erase(callback_itr);
 	}
 
@@ -61,6 +61,15 @@
 #define _likely(...) __builtin_expect(!!(__VA_ARGS__), true)
 #define _unlikely(...) __builtin_expect(!!(__VA_ARGS__), false)
 
+// a hint for spin-wait loops
+static inline _always_inline void _cpu_relax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__)
+	__asm__ volatile ("yield" ::: "memory");
+#endif
+}
+
 static constexpr auto _const _parity(unsigned v) noexcept { return __builtin_parity(v); }
 static constexpr auto _const _parity(unsigned long v) noexcept { return __builtin_parityl(v); }
 static constexpr auto _const _parity(unsigned long long v) noexcept { return __builtin_parityll(v); }
@@ -101,6 +110,8 @@ static constexpr unsigned __int128 _const bswap(unsigned __int128 v) noexcept {
 #define _likely(...) (__VA_ARGS__)
 #define _unlikely(...) (__VA_ARGS__)
 
+static inline void _cpu_relax() noexcept { }
+
 #endif
 
 template <typename T> static constexpr std::enable_if_t<std::is_enum_v<T>, T> _const bswap(T v) noexcept { return static_cast<T>(bswap(static_cast<std::underlying_type_t<T>>(v))); }
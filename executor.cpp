@@ -0,0 +1,85 @@
+#include "executor.h"
+
+
+Executor::Executor(size_t n) : n(n ?: 1), workers(new Worker[this->n]), rotor(), stopping() {
+}
+
+Executor::~Executor() {
+	stopping.store(true, std::memory_order_release);
+	for (size_t i = 0; i < n; ++i) {
+		// taking the lock orders the store before any worker's next check of its predicate
+		std::lock_guard<mutex_t> lock(workers[i].mutex);
+		workers[i].condition.notify_all();
+	}
+	for (auto &thread : threads) {
+		thread.join();
+	}
+}
+
+void Executor::start() {
+	for (size_t i = 0; i < n; ++i) {
+		threads.emplace_back(&Executor::work, this, i);
+	}
+}
+
+void Executor::push(task_t &&task) {
+	// start the scan at a rotating worker so that ties do not all land on the first
+	size_t start = rotor.fetch_add(1, std::memory_order_relaxed), best = start % n, best_load = SIZE_MAX;
+	for (size_t j = 0; j < n && best_load; ++j) {
+		size_t i = (start + j) % n, load = workers[i].load.load(std::memory_order_relaxed);
+		if (load < best_load) {
+			best = i, best_load = load;
+		}
+	}
+	Worker &worker = workers[best];
+	worker.load.fetch_add(1, std::memory_order_relaxed);
+	{
+		std::lock_guard<mutex_t> lock(worker.mutex);
+		worker.tasks.push_back(std::move(task));
+	}
+	worker.condition.notify_one();
+}
+
+bool Executor::steal(size_t thief, task_t &task) {
+	for (size_t j = 1; j < n; ++j) {
+		Worker &victim = workers[(thief + j) % n];
+		if (victim.load.load(std::memory_order_relaxed) > 1) {
+			std::unique_lock<mutex_t> lock(victim.mutex, std::try_to_lock);
+			if (lock && !victim.tasks.empty()) {
+				// the owner works from the front, so take the newest task from the back
+				task = std::move(victim.tasks.back());
+				victim.tasks.pop_back();
+				victim.load.fetch_sub(1, std::memory_order_relaxed);
+				workers[thief].load.fetch_add(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void Executor::work(size_t i) {
+	Worker &worker = workers[i];
+	while (!stopping.load(std::memory_order_acquire)) {
+		task_t task;
+		{
+			std::unique_lock<mutex_t> lock(worker.mutex);
+			if (worker.tasks.empty()) {
+				lock.unlock();
+				if (!this->steal(i, task)) {
+					lock.lock();
+					worker.condition.wait(lock, [this, &worker]() noexcept { return !worker.tasks.empty() || stopping.load(std::memory_order_acquire); });
+					if (worker.tasks.empty()) {
+						return;
+					}
+				}
+			}
+			if (!task) {
+				task = std::move(worker.tasks.front());
+				worker.tasks.pop_front();
+			}
+		}
+		task();
+		worker.load.fetch_sub(1, std::memory_order_relaxed);
+	}
+}
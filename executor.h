@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "compiler.h"
+#include "smallfunction.h"
+#include "sync.h"
+
+
+// A fixed set of worker threads, each with its own task deque. New tasks go to the least-loaded
+// worker, and a worker that runs out of tasks steals from the others before going to sleep. Tasks
+// are noexcept, so a task that could throw does not compile rather than taking down its worker.
+class Executor {
+
+public:
+	typedef SmallFunction<void (void) noexcept> task_t;
+
+private:
+	struct Worker {
+		mutex_t mutex;
+		condition_variable_t condition;
+		std::deque<task_t> tasks;
+		std::atomic<size_t> load; // queued plus running
+		Worker() : load() { }
+	};
+
+private:
+	size_t n;
+	std::unique_ptr<Worker[]> workers;
+	std::atomic<size_t> rotor;
+	std::atomic<bool> stopping;
+	std::vector<std::thread> threads;
+
+public:
+	explicit Executor(size_t n = std::thread::hardware_concurrency());
+	// lets running tasks finish, joins the workers and destroys the tasks they had yet to start
+	~Executor();
+
+private:
+	Executor(const Executor &) = delete;
+	Executor & operator=(const Executor &) = delete;
+
+public:
+	size_t _pure size() const noexcept { return n; }
+
+	// Runs every worker on its own thread until the Executor is destroyed.
+	void start();
+
+	template <typename T>
+	void execute(T &&task) { this->push(task_t(std::forward<T>(task))); }
+
+private:
+	void push(task_t &&task);
+	bool steal(size_t thief, task_t &task);
+	void work(size_t i);
+
+};
@@ -25,6 +25,14 @@ void madvise(void *addr, size_t length, int advice) {
 	}
 }
 
+int memfd_create(const char *name, unsigned flags) {
+	int ret;
+	if (_unlikely((ret = ::memfd_create(name, flags)) < 0)) {
+		throw std::system_error(errno, std::system_category(), "memfd_create");
+	}
+	return ret;
+}
+
 void * mremap(void *old_address, size_t old_size, size_t new_size, int flags) {
 	void *ret;
 	if (_unlikely((ret = ::mremap(old_address, old_size, new_size, flags)) == MAP_FAILED)) {
@@ -23,6 +23,7 @@
 namespace linux {
 	void fallocate(int fd, int mode, off_t offset, off_t len);
 	void madvise(void *addr, size_t length, int advice);
+	_nodiscard int memfd_create(const char *name, unsigned flags = MFD_CLOEXEC);
 	_nodiscard void * mremap(void *old_address, size_t old_size, size_t new_size, int flags = 0);
 	_nodiscard void * mremap(void *old_address, size_t old_size, size_t new_size, int flags, void *new_address);
 }
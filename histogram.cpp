@@ -0,0 +1,33 @@
+#include "histogram.h"
+
+#include <cmath>
+
+
+uint64_t Histogram::Snapshot::percentile(double fraction) const noexcept {
+	auto rank = static_cast<uint64_t>(std::ceil(std::clamp(fraction, 0.0, 1.0) * static_cast<double>(total)));
+	uint64_t seen = 0;
+	for (unsigned bucket = 0; bucket < buckets; ++bucket) {
+		if ((seen += counts[bucket]) >= rank && seen) {
+			return std::min(highest_in(bucket), maximum);
+		}
+	}
+	return maximum;
+}
+
+auto Histogram::Snapshot::operator+=(const Snapshot &other) noexcept -> Snapshot & {
+	for (unsigned bucket = 0; bucket < buckets; ++bucket) {
+		counts[bucket] += other.counts[bucket];
+	}
+	total += other.total, sum += other.sum, maximum = std::max(maximum, other.maximum);
+	return *this;
+}
+
+auto Histogram::snapshot() const noexcept -> Snapshot {
+	Snapshot snapshot;
+	snapshot.maximum = maximum.load(std::memory_order_relaxed);
+	snapshot.sum = sum.load(std::memory_order_relaxed);
+	for (unsigned bucket = 0; bucket < buckets; ++bucket) {
+		snapshot.total += snapshot.counts[bucket] = counts[bucket].load(std::memory_order_relaxed);
+	}
+	return snapshot;
+}
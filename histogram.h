@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "bit.h"
+#include "compiler.h"
+
+
+// A log-linear histogram of unsigned 64-bit values in the style of HdrHistogram: each power of two
+// is split into 16 equal sub-buckets, so any recorded value is reported to within 1/16 of itself.
+// Recording is wait-free but assumes a single writer; snapshots may be taken from any thread.
+class Histogram {
+
+public:
+	static constexpr unsigned sub_bucket_bits = 4, sub_buckets = 1u << sub_bucket_bits;
+	static constexpr unsigned buckets = (64 - sub_bucket_bits + 1) * sub_buckets;
+
+	static constexpr unsigned _const bucket_of(uint64_t value) noexcept {
+		unsigned shift = std::max(static_cast<unsigned>(std::bit_width(value)), sub_bucket_bits + 1) - (sub_bucket_bits + 1);
+		return (shift << sub_bucket_bits) + static_cast<unsigned>(value >> shift);
+	}
+	static constexpr uint64_t _const lowest_in(unsigned bucket) noexcept {
+		return bucket < 2 * sub_buckets ? bucket : (uint64_t(sub_buckets) | (bucket & (sub_buckets - 1))) << ((bucket >> sub_bucket_bits) - 1);
+	}
+	static constexpr uint64_t _const highest_in(unsigned bucket) noexcept {
+		return bucket + 1 < buckets ? lowest_in(bucket + 1) - 1 : UINT64_MAX;
+	}
+
+	class Snapshot {
+		friend Histogram;
+	private:
+		std::array<uint64_t, buckets> counts;
+		uint64_t total, sum, maximum;
+	public:
+		Snapshot() noexcept : counts(), total(), sum(), maximum() { }
+	public:
+		uint64_t _pure count() const noexcept { return total; }
+		uint64_t _pure max() const noexcept { return maximum; }
+		double _pure mean() const noexcept { return total ? static_cast<double>(sum) / static_cast<double>(total) : 0; }
+		uint64_t _pure count(unsigned bucket) const noexcept { return counts[bucket]; }
+		// the smallest bucket bound at or below which the given fraction (0 to 1) of values lie
+		uint64_t _pure percentile(double fraction) const noexcept;
+		Snapshot & operator+=(const Snapshot &other) noexcept;
+	};
+
+private:
+	std::array<std::atomic<uint64_t>, buckets> counts;
+	std::atomic<uint64_t> sum, maximum;
+
+public:
+	Histogram() noexcept : counts(), sum(), maximum() { }
+
+private:
+	Histogram(const Histogram &) = delete;
+	Histogram & operator=(const Histogram &) = delete;
+
+public:
+	void record(uint64_t value) noexcept {
+		increment(counts[bucket_of(value)], 1);
+		increment(sum, value);
+		if (value > maximum.load(std::memory_order_relaxed)) {
+			maximum.store(value, std::memory_order_relaxed);
+		}
+	}
+
+	// the sum and maximum may be a record behind the counts if taken while the writer is recording
+	Snapshot snapshot() const noexcept;
+
+private:
+	static void increment(std::atomic<uint64_t> &counter, uint64_t n) noexcept {
+		counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+	}
+
+};
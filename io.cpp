@@ -40,6 +40,9 @@ ssize_t BufferedSource::read(void *buf, size_t n) {
 	if (n == 0) {
 		return 0;
 	}
+	if (_unlikely(!bptr)) {
+		this->resize(buffer_size);
+	}
 	size_t b = pptr - gptr;
 	if (b > 0) {
 		if (n <= b) {
@@ -72,6 +75,9 @@ size_t BufferedSink::write(const void *buf, size_t n) {
 	if (n == 0) {
 		return 0;
 	}
+	if (_unlikely(!bptr)) {
+		this->resize(buffer_size);
+	}
 	size_t r = eptr - pptr;
 	if (r > 0) {
 		if (n < r) {
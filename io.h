@@ -337,16 +337,21 @@ class BufferedSource : public Source, protected DynamicBuffer {
 
 protected:
 	Source &source;
+	size_t buffer_size;
 
 public:
 	explicit BufferedSource(Source &source) : BufferedSource(source, 8192) { }
+	BufferedSource(Source &source, BufferPool &pool) : BufferedSource(source, 8192, pool) { }
 
 	template <typename... Args>
-	explicit BufferedSource(Source &source, Args &&...args) : DynamicBuffer(std::forward<Args>(args)...), source(source) { }
+	explicit BufferedSource(Source &source, Args &&...args) : DynamicBuffer(std::forward<Args>(args)...), source(source), buffer_size(this->size()) { }
 
 public:
 	_nodiscard ssize_t read(void *buf, size_t n) override;
 
+	// gives up the buffer, to its pool if it has one, unless it holds unread data; the next read takes another
+	void idle() noexcept { if (gptr == pptr) this->release(); }
+
 };
 
 
@@ -354,17 +359,22 @@ class BufferedSink : public Sink, protected DynamicBuffer {
 
 protected:
 	Sink &sink;
+	size_t buffer_size;
 
 public:
 	explicit BufferedSink(Sink &sink) : BufferedSink(sink, 8192) { }
+	BufferedSink(Sink &sink, BufferPool &pool) : BufferedSink(sink, 8192, pool) { }
 
 	template <typename... Args>
-	explicit BufferedSink(Sink &sink, Args &&...args) : DynamicBuffer(std::forward<Args>(args)...), sink(sink) { }
+	explicit BufferedSink(Sink &sink, Args &&...args) : DynamicBuffer(std::forward<Args>(args)...), sink(sink), buffer_size(this->size()) { }
 
 public:
 	_nodiscard size_t write(const void *buf, size_t n) override;
 	bool flush() override;
 
+	// gives up the buffer, to its pool if it has one, unless it holds unflushed data; the next write takes another
+	void idle() noexcept { if (gptr == pptr) this->release(); }
+
 };
 
 
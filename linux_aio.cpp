@@ -1,5 +1,8 @@
 #include "linux_aio.h"
 
+#include <algorithm>
+#include <cstring>
+#include <new>
 #include <system_error>
 
 #include "compiler.h"
@@ -42,4 +45,209 @@ size_t AIOContext::getevents(size_t min_nr, size_t nr, struct io_event events[],
 	return static_cast<size_t>(ret);
 }
 
+
+size_t SelectableAIOContext::submit(std::span<Operation * const> operations) {
+	struct iocb *iocbs[batch];
+	size_t n = std::min(operations.size(), batch);
+	for (size_t i = 0; i < n; ++i) {
+		Operation *operation = operations[i];
+		operation->iocb.data = operation;
+		::io_set_eventfd(&operation->iocb, fd);
+		iocbs[i] = &operation->iocb;
+	}
+	return this->AIOContext::submit(n, iocbs);
+}
+
+void SelectableAIOContext::submit(Operation &operation) {
+	Operation *operations[] = { &operation };
+	while (this->submit(operations) == 0);
+}
+
+void SelectableAIOContext::selected(Selector &selector, Selector::Flags) noexcept {
+	struct io_event events[batch];
+	struct timespec zero = { };
+	try {
+		if (this->read() == 0) {
+			return;
+		}
+		for (size_t n; (n = this->getevents(0, batch, events, &zero)) > 0;) {
+			for (size_t i = 0; i < n; ++i) {
+				try {
+					static_cast<Operation *>(events[i].data)->callback(selector, static_cast<long>(events[i].res));
+				}
+				catch (...) {
+				}
+			}
+			if (n < batch) {
+				break;
+			}
+		}
+	}
+	catch (...) {
+	}
+}
+
+
+_AsyncFile::_AsyncFile(FileDescriptor &fd, size_t block_size, unsigned depth, off_t offset) :
+		fd(fd), block_size((block_size + alignment - 1) & ~(alignment - 1)), depth(std::max(depth, 1u)),
+		buffers(static_cast<std::byte *>(std::aligned_alloc(alignment, this->block_size * this->depth))), slots(new Slot[this->depth]()),
+		ctx(this->depth), offset(offset), head(), in_flight()
+{
+	if (_unlikely(!buffers)) {
+		throw std::bad_alloc();
+	}
+}
+
+void _AsyncFile::submit(unsigned first, unsigned count) {
+	struct iocb *iocbs[batch];
+	for (unsigned base = 0; base < count;) {
+		unsigned n = std::min(count - base, batch), done = 0;
+		for (unsigned i = 0; i < n; ++i) {
+			Slot &slot = slots[(first + base + i) % depth];
+			slot.iocb.data = &slot;
+			slot.pending = true;
+			iocbs[i] = &slot.iocb;
+		}
+		try {
+			while (done < n) {
+				unsigned accepted = static_cast<unsigned>(ctx.submit(n - done, iocbs + done));
+				done += accepted, in_flight += accepted;
+			}
+		}
+		catch (...) {
+			// those the kernel did not accept will never complete
+			for (unsigned i = done; i < n; ++i) {
+				Slot &slot = slots[(first + base + i) % depth];
+				slot.result = -ECANCELED, slot.pending = false;
+			}
+			throw;
+		}
+		base += n;
+	}
+}
+
+long _AsyncFile::complete(unsigned slot) {
+	while (slots[slot].pending) {
+		this->reap(1);
+	}
+	return slots[slot].result;
+}
+
+size_t _AsyncFile::wait(unsigned slot) {
+	long result = this->complete(slot);
+	if (_unlikely(result < 0)) {
+		throw std::system_error(static_cast<int>(-result), std::system_category(), "aio");
+	}
+	return static_cast<size_t>(result);
+}
+
+void _AsyncFile::wait_all() {
+	while (in_flight) {
+		this->reap(in_flight);
+	}
+}
+
+void _AsyncFile::reap(size_t min_nr) {
+	struct io_event events[batch];
+	size_t n = ctx.getevents(std::min(min_nr, size_t(batch)), batch, events);
+	for (size_t i = 0; i < n; ++i) {
+		Slot *slot = static_cast<Slot *>(events[i].data);
+		slot->result = static_cast<long>(events[i].res);
+		slot->pending = false;
+	}
+	in_flight -= static_cast<unsigned>(n);
+}
+
+
+AsyncFileSource::AsyncFileSource(FileDescriptor &fd, size_t block_size, unsigned depth, off_t offset) : _AsyncFile(fd, block_size, depth, offset), consumed(), eof() {
+	for (unsigned i = 0; i < this->depth; ++i) {
+		::io_prep_pread(&slots[i].iocb, fd, this->buffer(i), this->block_size, this->offset);
+		this->offset += this->block_size;
+	}
+	this->submit(0, this->depth);
+}
+
+ssize_t AsyncFileSource::read(void *buf, size_t n) {
+	for (;;) {
+		if (_unlikely(eof)) {
+			return -1;
+		}
+		size_t available = this->wait(head);
+		if (consumed < available) {
+			n = std::min(n, available - consumed);
+			std::memcpy(buf, this->buffer(head) + consumed, n);
+			consumed += n;
+			return static_cast<ssize_t>(n);
+		}
+		if (available < block_size) {
+			// a short read means end of file; whatever is still in flight lies beyond it
+			eof = true;
+			continue;
+		}
+		::io_prep_pread(&slots[head].iocb, fd, this->buffer(head), block_size, offset);
+		offset += block_size;
+		this->submit(head, 1);
+		head = (head + 1) % depth, consumed = 0;
+	}
+}
+
+
+AsyncFileSink::AsyncFileSink(FileDescriptor &fd, size_t block_size, unsigned depth, off_t offset) : _AsyncFile(fd, block_size, depth, offset), filled() {
+	// a slot that has yet to be written from passes check() as though its last write were complete
+	for (unsigned i = 0; i < this->depth; ++i) {
+		slots[i].result = static_cast<long>(this->block_size);
+	}
+}
+
+AsyncFileSink::~AsyncFileSink() {
+	try {
+		this->flush();
+	}
+	catch (...) {
+	}
+}
+
+size_t AsyncFileSink::write(const void *buf, size_t n) {
+	this->check(head);
+	n = std::min(n, block_size - filled);
+	std::memcpy(this->buffer(head) + filled, buf, n);
+	if ((filled += n) == block_size) {
+		::io_prep_pwrite(&slots[head].iocb, fd, this->buffer(head), block_size, offset);
+		offset += block_size;
+		this->submit(head, 1);
+		head = (head + 1) % depth, filled = 0;
+	}
+	return n;
+}
+
+bool AsyncFileSink::flush() {
+	if (filled) {
+		// the block is rewritten in place if more data follows
+		std::memset(this->buffer(head) + filled, 0, block_size - filled);
+		::io_prep_pwrite(&slots[head].iocb, fd, this->buffer(head), block_size, offset);
+		this->submit(head, 1);
+	}
+	this->wait_all();
+	for (unsigned i = 0; i < depth; ++i) {
+		this->check(i);
+	}
+	if (filled) {
+		fd.ftruncate(offset + static_cast<off_t>(filled));
+	}
+	return true;
+}
+
+// whether its write is still pending or was reaped while waiting for another, a slot's last result is
+// checked before the slot is reused, and then reset so that each failure is reported once
+void AsyncFileSink::check(unsigned slot) {
+	long result = this->complete(slot);
+	slots[slot].result = static_cast<long>(block_size);
+	if (_unlikely(result < 0)) {
+		throw std::system_error(static_cast<int>(-result), std::system_category(), "aio");
+	}
+	if (_unlikely(static_cast<size_t>(result) != block_size)) {
+		throw std::system_error(EIO, std::system_category(), "aio");
+	}
+}
+
 } // namespace linux
@@ -1,5 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+
 #include <libaio.h>
 
+#include "fd.h"
+#include "io.h"
+#include "linux_eventfd.h"
+#include "smallfunction.h"
+#include "span.h"
+
 
 #undef linux
 namespace linux {
@@ -20,4 +32,133 @@ public:
 
 };
 
+
+// An AIOContext whose completions are reaped on a Selector's thread instead of by blocking in getevents.
+// Submitted iocbs are tagged with IOCB_FLAG_RESFD so that the kernel signals our eventfd as they complete,
+// and each readiness of the eventfd reaps completions in batches and calls their callbacks in turn.
+// Register it with Selector::Flags::READABLE | Selector::Flags::PERSISTENT, and remove it before destroying it.
+class SelectableAIOContext : public AIOContext, public EventFD, public Selectable {
+
+public:
+	static constexpr size_t batch = 64;
+
+	// called with the operation's result: the number of bytes transferred, or a negated errno
+	typedef SmallFunction<void (Selector &, long)> callback_t;
+
+	// must remain alive and in place from submission until its callback is called
+	struct Operation {
+		struct iocb iocb;
+		callback_t callback;
+	};
+
+public:
+	explicit SelectableAIOContext(unsigned nr_events) : AIOContext(nr_events), EventFD(0, EFD_NONBLOCK | EFD_CLOEXEC) { }
+
+public:
+	// submits up to batch operations whose iocbs have been prepared; returns how many were accepted
+	size_t submit(std::span<Operation * const> operations);
+	void submit(Operation &operation);
+
+protected:
+	void selected(Selector &selector, Selector::Flags flags) noexcept override;
+
+};
+
+
+// The machinery shared by AsyncFileSource and AsyncFileSink: a fixed pool of block-sized, block-aligned
+// buffers, each with its own iocb, that take turns in order between the caller and the kernel. The
+// file should be opened with O_DIRECT, in which case block_size and the starting offset must be
+// multiples of its logical block size.
+class _AsyncFile {
+
+public:
+	static constexpr size_t alignment = 4096;
+	static constexpr unsigned batch = 64; // iocbs submitted or events reaped per system call
+
+protected:
+	struct Slot {
+		struct iocb iocb;
+		long result; // bytes transferred, or a negated errno
+		bool pending;
+	};
+
+	struct Free {
+		void operator () (void *ptr) const noexcept { std::free(ptr); }
+	};
+
+protected:
+	FileDescriptor &fd;
+	const size_t block_size;
+	const unsigned depth;
+	const std::unique_ptr<std::byte[], Free> buffers;
+	const std::unique_ptr<Slot[]> slots;
+	// destroyed before the buffers, as io_destroy waits for any operations still in flight
+	AIOContext ctx;
+	off_t offset; // of the next block to be submitted
+	unsigned head; // the slot being drained or filled by the caller
+	unsigned in_flight;
+
+protected:
+	_AsyncFile(FileDescriptor &fd, size_t block_size, unsigned depth, off_t offset);
+
+private:
+	_AsyncFile(const _AsyncFile &) = delete;
+	_AsyncFile & operator=(const _AsyncFile &) = delete;
+
+protected:
+	std::byte * buffer(unsigned slot) const noexcept { return buffers.get() + slot * block_size; }
+
+	void submit(unsigned first, unsigned count);
+	// waits for the given slot's operation to complete and returns its result
+	long complete(unsigned slot);
+	// as complete, but returns the number of bytes transferred and throws if the operation failed
+	size_t wait(unsigned slot);
+	void wait_all();
+
+private:
+	void reap(size_t min_nr);
+
+};
+
+
+// Reads a file sequentially, keeping up to depth reads of block_size bytes in flight ahead of the caller.
+class AsyncFileSource : public Source, private _AsyncFile {
+
+private:
+	size_t consumed; // from the head slot
+	bool eof;
+
+public:
+	explicit AsyncFileSource(FileDescriptor &fd, size_t block_size = 1 << 20, unsigned depth = 8, off_t offset = 0);
+
+public:
+	_nodiscard ssize_t read(void *buf, size_t n) override;
+	using Source::read;
+
+};
+
+
+// Writes a file sequentially, keeping up to depth writes of block_size bytes in flight behind the caller.
+// flush() writes out a final partial block padded to the block size, waits for all writes to complete,
+// and then truncates the file to the length written.
+class AsyncFileSink : public Sink, private _AsyncFile {
+
+private:
+	size_t filled; // in the head slot
+
+public:
+	explicit AsyncFileSink(FileDescriptor &fd, size_t block_size = 1 << 20, unsigned depth = 8, off_t offset = 0);
+	~AsyncFileSink() override;
+
+public:
+	_nodiscard size_t write(const void *buf, size_t n) override;
+	using Sink::write;
+
+	bool flush() override;
+
+private:
+	void check(unsigned slot);
+
+};
+
 } // namespace linux
@@ -34,4 +34,27 @@ bool EventFD::write(eventfd_t value) {
 }
 
 
+void SelectableNotifier::selected(Selector &selector, Selector::Flags) noexcept {
+	try {
+		// drain the eventfd before taking the count, so that a notifier that finds the count at zero
+		// after we have taken it is sure to wake us again
+		if (this->read() == 0) {
+			return;
+		}
+	}
+	catch (...) {
+		return;
+	}
+	if (uint64_t count = pending.exchange(0, std::memory_order_acquire)) {
+		this->notified(selector, count);
+	}
+}
+
+void SelectableNotifier::wake() {
+	if (_unlikely(!this->write(1))) {
+		throw std::system_error(EAGAIN, std::system_category(), "eventfd_write");
+	}
+}
+
+
 } // namespace linux
@@ -1,6 +1,12 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
 #include <sys/eventfd.h>
 
 #include "fd.h"
+#include "selector.h"
 
 
 #undef linux
@@ -19,4 +25,37 @@ public:
 };
 
 
+// A channel through which any thread can wake a Selector's thread. notify() counts the notification and
+// writes to the eventfd only if none was already pending, so a burst of notifications costs one system
+// call and one wakeup; notified() is then passed the number of notifications it has absorbed. Register it
+// with Selector::Flags::READABLE | Selector::Flags::PERSISTENT, and remove it before destroying it. flags
+// may include EFD_SEMAPHORE for a channel that several Selectors consume, so that each wakeup is taken by
+// only one of them.
+class SelectableNotifier : public EventFD, public Selectable {
+
+private:
+	alignas(64) std::atomic<uint64_t> pending;
+
+public:
+	explicit SelectableNotifier(int flags = 0) : EventFD(0, flags | EFD_NONBLOCK | EFD_CLOEXEC), pending() { }
+
+public:
+	void notify(uint64_t n = 1) {
+		if (pending.fetch_add(n, std::memory_order_release) == 0) {
+			this->wake();
+		}
+	}
+
+protected:
+	virtual void notified(Selector &selector, uint64_t count) noexcept = 0;
+
+protected:
+	void selected(Selector &selector, Selector::Flags flags) noexcept override;
+
+private:
+	void wake();
+
+};
+
+
 } // namespace linux
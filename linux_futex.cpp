@@ -1,7 +1,23 @@
 #include "linux_futex.h"
 
+#include <climits>
 #include <system_error>
 
+#include <unistd.h>
+
+#ifndef SYS_futex_waitv
+#define SYS_futex_waitv 449
+#endif
+#ifndef FUTEX_32
+#define FUTEX_32 2
+struct futex_waitv {
+	__u64 val;
+	__u64 uaddr;
+	__u32 flags;
+	__u32 __reserved;
+};
+#endif
+
 
 namespace linux {
 
@@ -21,6 +37,16 @@ unsigned futex_wake_bitset(int *uaddr, int count, unsigned mask) {
 	return static_cast<unsigned>(ret);
 }
 
+int futex_cmp_requeue(int *uaddr, int count, int requeue, int *uaddr2, int expect) {
+	int ret;
+	if ((ret = ::futex(uaddr, FUTEX_CMP_REQUEUE_PRIVATE, count, static_cast<uint32_t>(requeue), uaddr2, expect)) < 0) {
+		if (_unlikely(errno != EAGAIN)) {
+			throw std::system_error(errno, std::system_category(), "futex");
+		}
+	}
+	return ret;
+}
+
 bool futex_wait(int *uaddr, int expect, const struct timespec *timeout) {
 	if (::futex(uaddr, FUTEX_WAIT_PRIVATE, expect, timeout) < 0) {
 		if (_unlikely(errno != EAGAIN && errno != EINTR && errno != ETIMEDOUT)) {
@@ -41,6 +67,66 @@ bool futex_wait_bitset(int *uaddr, int expect, unsigned mask, const struct times
 	return true;
 }
 
+static int find_changed(std::span<const FutexWait> waits) noexcept {
+	for (size_t i = 0; i < waits.size(); ++i) {
+		if (__atomic_load_n(waits[i].uaddr, __ATOMIC_RELAXED) != waits[i].expect) {
+			return static_cast<int>(i);
+		}
+	}
+	return -1;
+}
+
+bool FutexGroup::waitv_supported() noexcept {
+	// with no waiters, a kernel that knows the call rejects it with EINVAL; any other error, such as EPERM
+	// from a seccomp filter, means that we cannot use it
+	static const bool supported = ::syscall(SYS_futex_waitv, nullptr, 0, 0, nullptr, CLOCK_MONOTONIC) < 0 && errno == EINVAL;
+	return supported;
+}
+
+unsigned FutexGroup::wake(int *uaddr, int count) {
+	unsigned woken = futex_wake(uaddr, count);
+	if (!waitv_supported()) {
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		int v = __atomic_load_n(&epoch, __ATOMIC_RELAXED);
+		while (v & 1) {
+			if (__atomic_compare_exchange_n(&epoch, &v, (v + 2) & ~1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				woken += futex_wake(&epoch, INT_MAX);
+				break;
+			}
+		}
+	}
+	return woken;
+}
+
+int FutexGroup::wait_any(std::span<const FutexWait> waits, const struct timespec *deadline) {
+	if (_unlikely(waits.empty() || waits.size() > max_waits)) {
+		throw std::system_error(EINVAL, std::system_category(), "futex_waitv");
+	}
+	if (waitv_supported()) {
+		struct futex_waitv waitv[max_waits];
+		for (size_t i = 0; i < waits.size(); ++i) {
+			waitv[i] = { static_cast<__u32>(waits[i].expect), reinterpret_cast<uintptr_t>(waits[i].uaddr), FUTEX_32 | FUTEX_PRIVATE_FLAG, 0 };
+		}
+		int ret;
+		if ((ret = static_cast<int>(::syscall(SYS_futex_waitv, waitv, static_cast<unsigned>(waits.size()), 0, deadline, CLOCK_MONOTONIC))) < 0) {
+			if (errno == EAGAIN) {
+				return find_changed(waits);
+			}
+			if (_unlikely(errno != EINTR && errno != ETIMEDOUT)) {
+				throw std::system_error(errno, std::system_category(), "futex_waitv");
+			}
+		}
+		return ret;
+	}
+	int v = __atomic_or_fetch(&epoch, 1, __ATOMIC_SEQ_CST);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (int i = find_changed(waits); i >= 0) {
+		return i;
+	}
+	futex_wait_bitset(&epoch, v, FUTEX_BITSET_MATCH_ANY, deadline);
+	return -1;
+}
+
 bool futex_wait_bitset(int *uaddr, int expect, unsigned mask, std::chrono::system_clock::time_point deadline) {
 	struct timespec ts = posix::duration_to_timespec(deadline.time_since_epoch());
 	if (::futex(uaddr, FUTEX_WAIT_BITSET_PRIVATE | FUTEX_CLOCK_REALTIME, expect, &ts, mask) < 0) {
@@ -1,3 +1,5 @@
+#pragma once
+
 #include <cerrno>
 #include <chrono>
 
@@ -6,6 +8,7 @@
 
 #include "clock.h"
 #include "compiler.h"
+#include "span.h"
 
 
 #if defined(__GNUC__) && defined(__OPTIMIZE__) && defined(__amd64__)
@@ -99,6 +102,10 @@ unsigned futex_wake(int *uaddr, int count);
 
 unsigned futex_wake_bitset(int *uaddr, int count, unsigned mask);
 
+// wakes up to count waiters on uaddr and moves up to requeue more onto uaddr2, if *uaddr still equals expect;
+// returns the number woken plus requeued, or -1 if *uaddr changed
+int futex_cmp_requeue(int *uaddr, int count, int requeue, int *uaddr2, int expect);
+
 bool futex_wait(int *uaddr, int expect, const struct timespec *timeout = nullptr);
 
 static inline bool futex_wait(int *uaddr, int expect, std::chrono::steady_clock::duration timeout) {
@@ -115,4 +122,46 @@ static inline bool futex_wait_bitset(int *uaddr, int expect, unsigned mask, std:
 	return futex_wait_bitset(uaddr, expect, mask, &ts);
 }
 
+
+struct FutexWait {
+	int *uaddr;
+	int expect;
+};
+
+// Lets a thread wait on several futex words at once, in a single system call where the kernel has
+// FUTEX_WAITV (Linux 5.16). On older kernels, waiters sleep on one shared word that wake() bumps,
+// so anything that may be waited on through a group must be woken through that group.
+class FutexGroup {
+
+public:
+	static constexpr size_t max_waits = 128; // the kernel's FUTEX_WAITV_MAX
+
+private:
+	int epoch; // bumped by twos; the lowest bit says whether a waiter may be asleep on it
+
+public:
+	constexpr FutexGroup() noexcept : epoch() { }
+
+private:
+	FutexGroup(const FutexGroup &) = delete;
+	FutexGroup & operator=(const FutexGroup &) = delete;
+
+public:
+	static bool waitv_supported() noexcept;
+
+	// wakes up to count threads waiting on uaddr, including through this group
+	unsigned wake(int *uaddr, int count);
+
+	// returns the index of a word that was woken or no longer held its expected value, or -1 if the wait
+	// was interrupted, timed out or woken spuriously; deadline is against CLOCK_MONOTONIC; throws EINVAL
+	// if waits is empty or holds more than max_waits words
+	int wait_any(std::span<const FutexWait> waits, const struct timespec *deadline = nullptr);
+
+	int wait_any(std::span<const FutexWait> waits, std::chrono::steady_clock::time_point deadline) {
+		struct timespec ts = posix::duration_to_timespec(deadline.time_since_epoch());
+		return this->wait_any(waits, &ts);
+	}
+
+};
+
 } // namespace linux
@@ -0,0 +1,124 @@
+#include "linux_sync.h"
+
+
+namespace linux {
+
+
+// sleeps on uaddr while it equals expect; returns false once deadline, if any, has passed
+static bool wait_until(int *uaddr, int expect, const std::chrono::steady_clock::time_point *deadline) {
+	if (!deadline) {
+		futex_wait(uaddr, expect);
+		return true;
+	}
+	return futex_wait_bitset(uaddr, expect, FUTEX_BITSET_MATCH_ANY, *deadline) || std::chrono::steady_clock::now() < *deadline;
+}
+
+
+void FutexMutex::lock_slow() {
+	for (unsigned i = 0; i < spin_limit; ++i) {
+		int s = __atomic_load_n(&state, __ATOMIC_RELAXED);
+		if (s == 0 && this->try_lock()) {
+			return;
+		}
+		if (s == 2) {
+			break;
+		}
+		_cpu_relax();
+	}
+	this->lock_contended();
+}
+
+void FutexMutex::lock_contended() {
+	// having had to wait, assume others are waiting too and leave the mutex in state 2
+	while (__atomic_exchange_n(&state, 2, __ATOMIC_ACQUIRE) != 0) {
+		futex_wait(&state, 2);
+	}
+}
+
+
+void FutexCondition::notify_one() {
+	if (__atomic_load_n(&waiters, __ATOMIC_SEQ_CST)) {
+		__atomic_add_fetch(&seq, 1, __ATOMIC_SEQ_CST);
+		futex_wake(&seq, 1);
+	}
+}
+
+void FutexCondition::notify_all() {
+	if (__atomic_load_n(&waiters, __ATOMIC_SEQ_CST)) {
+		__atomic_add_fetch(&seq, 1, __ATOMIC_SEQ_CST);
+		futex_wake(&seq, INT_MAX);
+	}
+}
+
+void FutexCondition::notify_all(FutexMutex &mutex) {
+	if (__atomic_load_n(&waiters, __ATOMIC_SEQ_CST)) {
+		int next = __atomic_add_fetch(&seq, 1, __ATOMIC_SEQ_CST);
+		// the requeued waiters can only be woken by unlock() if the mutex is marked as contended
+		__atomic_store_n(&mutex.state, 2, __ATOMIC_RELAXED);
+		while (futex_cmp_requeue(&seq, 1, INT_MAX, &mutex.state, next) < 0) {
+			next = __atomic_load_n(&seq, __ATOMIC_RELAXED);
+		}
+	}
+}
+
+void FutexCondition::wait(FutexMutex &mutex, const std::chrono::steady_clock::time_point *deadline) {
+	// counted and sampled under the mutex, so a notifier that changed the predicate after we checked it
+	// sees us, and its bump of the sequence makes us return at once if we have yet to fall asleep
+	__atomic_add_fetch(&waiters, 1, __ATOMIC_SEQ_CST);
+	int v = __atomic_load_n(&seq, __ATOMIC_SEQ_CST);
+	mutex.unlock();
+	try {
+		linux::wait_until(&seq, v, deadline);
+	}
+	catch (...) {
+		__atomic_sub_fetch(&waiters, 1, __ATOMIC_RELAXED);
+		mutex.lock_contended();
+		throw;
+	}
+	__atomic_sub_fetch(&waiters, 1, __ATOMIC_RELAXED);
+	// we may have been requeued onto the mutex behind other waiters
+	mutex.lock_contended();
+}
+
+
+void FutexSemaphore::release(int n) {
+	int v = __atomic_add_fetch(&value, n << 1, __ATOMIC_RELEASE);
+	if ((v & 1) && futex_wake(&value, n) == 0) {
+		// nobody was asleep; a waiter that marks itself meanwhile just retries
+		__atomic_compare_exchange_n(&value, &v, v & ~1, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+	}
+}
+
+bool FutexSemaphore::acquire_slow(const std::chrono::steady_clock::time_point *deadline) {
+	for (;;) {
+		int v = __atomic_load_n(&value, __ATOMIC_RELAXED);
+		if (v >> 1 > 0) {
+			if (__atomic_compare_exchange_n(&value, &v, v - 2, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+				return true;
+			}
+		}
+		else if ((v & 1) || __atomic_compare_exchange_n(&value, &v, v | 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+			if (!linux::wait_until(&value, v | 1, deadline)) {
+				return this->try_acquire();
+			}
+		}
+	}
+}
+
+
+bool FutexEvent::wait_slow(const std::chrono::steady_clock::time_point *deadline) {
+	for (;;) {
+		int s = __atomic_load_n(&state, __ATOMIC_ACQUIRE);
+		if (s == 1) {
+			return true;
+		}
+		if (s == 2 || __atomic_compare_exchange_n(&state, &s, 2, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+			if (!linux::wait_until(&state, 2, deadline)) {
+				return this->is_set();
+			}
+		}
+	}
+}
+
+
+} // namespace linux
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <mutex>
+
+#include "compiler.h"
+#include "linux_futex.h"
+
+
+#undef linux
+namespace linux {
+
+
+template <typename Clock, typename Duration>
+static inline std::chrono::steady_clock::time_point to_steady(std::chrono::time_point<Clock, Duration> deadline) {
+	if constexpr (std::is_same_v<Clock, std::chrono::steady_clock>) {
+		return std::chrono::time_point_cast<std::chrono::steady_clock::duration>(deadline);
+	}
+	else {
+		return std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(deadline - Clock::now());
+	}
+}
+
+
+// A mutex in a single int: 0 when unlocked, 1 when locked, or 2 when locked and a thread may be
+// sleeping on it. lock() spins briefly before sleeping, and unlock() makes a system call only in state 2.
+class FutexMutex {
+	friend class FutexCondition;
+
+public:
+	static constexpr unsigned spin_limit = 100;
+
+private:
+	int state;
+
+public:
+	constexpr FutexMutex() noexcept : state() { }
+
+private:
+	FutexMutex(const FutexMutex &) = delete;
+	FutexMutex & operator=(const FutexMutex &) = delete;
+
+public:
+	_nodiscard bool try_lock() noexcept {
+		int expected = 0;
+		return __atomic_compare_exchange_n(&state, &expected, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+	}
+
+	void lock() {
+		if (_unlikely(!this->try_lock())) {
+			this->lock_slow();
+		}
+	}
+
+	void unlock() {
+		if (_unlikely(__atomic_exchange_n(&state, 0, __ATOMIC_RELEASE) == 2)) {
+			futex_wake(&state, 1);
+		}
+	}
+
+private:
+	void lock_slow();
+	void lock_contended();
+
+};
+
+
+// A condition variable in two ints: a sequence number, which every notification bumps before waking
+// anyone so that a waiter about to sleep notices, and a count of the threads that may be waiting, so
+// that notifying an idle condition makes no system call. notify_all(mutex) requeues the waiters onto
+// the mutex, so that they are woken one at a time as the mutex is handed on rather than all at once
+// to contend for it.
+class FutexCondition {
+
+private:
+	int seq;
+	unsigned waiters;
+
+public:
+	constexpr FutexCondition() noexcept : seq(), waiters() { }
+
+private:
+	FutexCondition(const FutexCondition &) = delete;
+	FutexCondition & operator=(const FutexCondition &) = delete;
+
+public:
+	void notify_one();
+	void notify_all();
+	// must be called with mutex held, and mutex must be the one the waiters are using
+	void notify_all(FutexMutex &mutex);
+
+	void wait(std::unique_lock<FutexMutex> &lock) { this->wait(*lock.mutex(), nullptr); }
+
+	template <typename Predicate>
+	void wait(std::unique_lock<FutexMutex> &lock, Predicate pred) {
+		while (!pred()) {
+			this->wait(lock);
+		}
+	}
+
+	template <typename Clock, typename Duration>
+	std::cv_status wait_until(std::unique_lock<FutexMutex> &lock, std::chrono::time_point<Clock, Duration> deadline) {
+		auto steady_deadline = to_steady(deadline);
+		this->wait(*lock.mutex(), &steady_deadline);
+		return Clock::now() < deadline ? std::cv_status::no_timeout : std::cv_status::timeout;
+	}
+
+	template <typename Clock, typename Duration, typename Predicate>
+	bool wait_until(std::unique_lock<FutexMutex> &lock, std::chrono::time_point<Clock, Duration> deadline, Predicate pred) {
+		while (!pred()) {
+			if (this->wait_until(lock, deadline) == std::cv_status::timeout) {
+				return pred();
+			}
+		}
+		return true;
+	}
+
+	template <typename Rep, typename Period>
+	std::cv_status wait_for(std::unique_lock<FutexMutex> &lock, std::chrono::duration<Rep, Period> timeout) {
+		return this->wait_until(lock, std::chrono::steady_clock::now() + timeout);
+	}
+
+	template <typename Rep, typename Period, typename Predicate>
+	bool wait_for(std::unique_lock<FutexMutex> &lock, std::chrono::duration<Rep, Period> timeout, Predicate pred) {
+		return this->wait_until(lock, std::chrono::steady_clock::now() + timeout, std::move(pred));
+	}
+
+private:
+	void wait(FutexMutex &mutex, const std::chrono::steady_clock::time_point *deadline);
+
+};
+
+
+// A counting semaphore in a single int: the count in the upper bits, and in the lowest bit whether a
+// thread may be sleeping, so that release() makes no system call while there are no waiters.
+class FutexSemaphore {
+
+private:
+	int value;
+
+public:
+	explicit constexpr FutexSemaphore(int count = 0) noexcept : value(count << 1) { }
+
+private:
+	FutexSemaphore(const FutexSemaphore &) = delete;
+	FutexSemaphore & operator=(const FutexSemaphore &) = delete;
+
+public:
+	_nodiscard bool try_acquire() noexcept {
+		for (int v = __atomic_load_n(&value, __ATOMIC_RELAXED); v >> 1 > 0;) {
+			if (__atomic_compare_exchange_n(&value, &v, v - 2, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void acquire() {
+		if (_unlikely(!this->try_acquire())) {
+			this->acquire_slow(nullptr);
+		}
+	}
+
+	template <typename Clock, typename Duration>
+	_nodiscard bool try_acquire_until(std::chrono::time_point<Clock, Duration> deadline) {
+		auto steady_deadline = to_steady(deadline);
+		return this->try_acquire() || this->acquire_slow(&steady_deadline);
+	}
+
+	template <typename Rep, typename Period>
+	_nodiscard bool try_acquire_for(std::chrono::duration<Rep, Period> timeout) {
+		return this->try_acquire_until(std::chrono::steady_clock::now() + timeout);
+	}
+
+	void release(int n = 1);
+
+private:
+	bool acquire_slow(const std::chrono::steady_clock::time_point *deadline);
+
+};
+
+
+// A one-shot event in a single int: 0 when unset, 1 once set, or 2 when unset and a thread may be sleeping.
+class FutexEvent {
+
+private:
+	int state;
+
+public:
+	constexpr FutexEvent() noexcept : state() { }
+
+private:
+	FutexEvent(const FutexEvent &) = delete;
+	FutexEvent & operator=(const FutexEvent &) = delete;
+
+public:
+	_nodiscard bool is_set() const noexcept { return __atomic_load_n(&state, __ATOMIC_ACQUIRE) == 1; }
+
+	void set() {
+		if (__atomic_exchange_n(&state, 1, __ATOMIC_RELEASE) == 2) {
+			futex_wake(&state, INT_MAX);
+		}
+	}
+
+	void wait() {
+		if (!this->is_set()) {
+			this->wait_slow(nullptr);
+		}
+	}
+
+	template <typename Clock, typename Duration>
+	_nodiscard bool try_wait_until(std::chrono::time_point<Clock, Duration> deadline) {
+		auto steady_deadline = to_steady(deadline);
+		return this->is_set() || this->wait_slow(&steady_deadline);
+	}
+
+	template <typename Rep, typename Period>
+	_nodiscard bool try_wait_for(std::chrono::duration<Rep, Period> timeout) {
+		return this->try_wait_until(std::chrono::steady_clock::now() + timeout);
+	}
+
+private:
+	bool wait_slow(const std::chrono::steady_clock::time_point *deadline);
+
+};
+
+
+} // namespace linux
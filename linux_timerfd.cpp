@@ -0,0 +1,39 @@
+#include "linux_timerfd.h"
+
+#include <system_error>
+
+
+namespace linux {
+
+
+_TimerFD::_TimerFD(clockid_t clock_id, int flags) : FileDescriptor(::timerfd_create(clock_id, flags)) {
+	if (_unlikely(fd < 0)) {
+		throw std::system_error(errno, std::system_category(), "timerfd_create");
+	}
+}
+
+void _TimerFD::get(struct itimerspec &spec) const {
+	if (_unlikely(::timerfd_gettime(fd, &spec) < 0)) {
+		throw std::system_error(errno, std::system_category(), "timerfd_gettime");
+	}
+}
+
+void _TimerFD::set(int flags, const struct itimerspec &new_spec, struct itimerspec *old_spec) {
+	if (_unlikely(::timerfd_settime(fd, flags, &new_spec, old_spec) < 0)) {
+		throw std::system_error(errno, std::system_category(), "timerfd_settime");
+	}
+}
+
+uint64_t _TimerFD::read() {
+	uint64_t expirations;
+	if (::read(fd, &expirations, sizeof expirations) < 0) {
+		if (_unlikely(errno != EAGAIN)) {
+			throw std::system_error(errno, std::system_category(), "read");
+		}
+		return 0;
+	}
+	return expirations;
+}
+
+
+} // namespace linux
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include <sys/timerfd.h>
+
+#include "fd.h"
+#include "selector.h"
+
+
+#undef linux
+namespace linux {
+
+
+class _TimerFD : public FileDescriptor {
+
+protected:
+	template <typename Clock>
+	struct clock_id { };
+
+public:
+	_TimerFD(clockid_t clock_id, int flags);
+
+public:
+	void get(struct itimerspec &spec) const;
+
+	void set(int flags, const struct itimerspec &new_spec, struct itimerspec *old_spec = nullptr);
+
+	// returns the number of expirations since the last read, or zero if there have been none
+	uint64_t read();
+
+protected:
+	void set(int flags, std::chrono::nanoseconds interval, std::chrono::nanoseconds value, struct itimerspec *old_spec) {
+		struct itimerspec new_spec;
+		new_spec.it_interval.tv_sec = static_cast<std::time_t>(std::chrono::duration_cast<std::chrono::seconds>(interval).count());
+		new_spec.it_interval.tv_nsec = static_cast<long>((interval % std::chrono::seconds(1)).count());
+		new_spec.it_value.tv_sec = static_cast<std::time_t>(std::chrono::duration_cast<std::chrono::seconds>(value).count());
+		new_spec.it_value.tv_nsec = static_cast<long>((value % std::chrono::seconds(1)).count());
+		this->set(flags, new_spec, old_spec);
+	}
+
+};
+
+
+template <>
+struct _TimerFD::clock_id<std::chrono::system_clock> : std::integral_constant<clockid_t, CLOCK_REALTIME> {
+};
+
+template <>
+struct _TimerFD::clock_id<std::chrono::steady_clock> : std::integral_constant<clockid_t, CLOCK_MONOTONIC> {
+};
+
+
+template <typename Clock = std::chrono::steady_clock>
+class TimerFD : public _TimerFD {
+
+public:
+	explicit TimerFD(int flags = TFD_NONBLOCK | TFD_CLOEXEC) : _TimerFD(clock_id<Clock>(), flags) { }
+
+public:
+	void set(typename Clock::time_point abs_value, typename Clock::duration interval = Clock::duration::zero(), struct itimerspec *old_spec = nullptr) {
+		this->_TimerFD::set(TFD_TIMER_ABSTIME, interval, abs_value.time_since_epoch(), old_spec);
+	}
+
+	void set(typename Clock::duration rel_value, typename Clock::duration interval = Clock::duration::zero(), struct itimerspec *old_spec = nullptr) {
+		this->_TimerFD::set(0, interval, rel_value, old_spec);
+	}
+
+	void clear(struct itimerspec *old_spec = nullptr) {
+		this->set(Clock::duration::zero(), Clock::duration::zero(), old_spec);
+	}
+
+};
+
+
+// A TimerFD serviced by a Selector, without a signal or thread of its own. Register it with
+// Selector::Flags::READABLE | Selector::Flags::PERSISTENT. expired() is passed the number of
+// expirations since the last call, which exceeds one if the selecting thread fell behind.
+template <typename Clock = std::chrono::steady_clock>
+class SelectableTimer : public TimerFD<Clock>, public Selectable {
+
+protected:
+	virtual void expired(Selector &selector, uint64_t expirations) noexcept = 0;
+
+protected:
+	void selected(Selector &selector, Selector::Flags) noexcept override {
+		if (uint64_t expirations = this->read()) {
+			this->expired(selector, expirations);
+		}
+	}
+
+};
+
+
+// Like Periodic, but work() runs on the selecting thread of the Selector given to schedule(), driven by
+// a timerfd rather than a Scheduler thread. All members must be called from that selecting thread.
+template <typename Clock = std::chrono::steady_clock>
+class SelectorPeriodic : private SelectableTimer<Clock> {
+
+public:
+	typedef Clock clock_t;
+	typedef typename clock_t::time_point time_point_t;
+	typedef typename clock_t::duration duration_t;
+
+private:
+	Selector *selector;
+	time_point_t deadline;
+
+protected:
+	SelectorPeriodic() : selector(), deadline() { }
+	explicit SelectorPeriodic(Selector &selector, time_point_t deadline = clock_t::now()) : selector(), deadline() { this->schedule(selector, deadline); }
+
+	~SelectorPeriodic() override {
+		if (selector) {
+			try {
+				selector->remove(*this);
+			}
+			catch (...) {
+			}
+		}
+	}
+
+public:
+	Selector * get_selector() const noexcept { return selector; }
+
+	time_point_t get_deadline() const noexcept { return deadline; }
+
+	void set_deadline(time_point_t deadline) {
+		// an all-zero expiry would disarm the timer, so a deadline at or before the epoch expires at once instead
+		this->TimerFD<Clock>::set((this->deadline = deadline).time_since_epoch() > duration_t::zero() ? deadline : time_point_t(duration_t(1)));
+	}
+
+	void schedule(Selector &selector, time_point_t deadline = clock_t::now()) {
+		if (this->selector != &selector) {
+			if (this->selector) {
+				this->selector->remove(*this);
+			}
+			selector.add(*this, static_cast<Selectable *>(this), Selector::Flags::READABLE | Selector::Flags::PERSISTENT);
+			this->selector = &selector;
+		}
+		this->set_deadline(deadline);
+	}
+
+	void cancel() { this->clear(); }
+
+protected:
+	virtual bool work(time_point_t &deadline) = 0;
+
+private:
+	void expired(Selector &, uint64_t) noexcept override {
+		time_point_t new_deadline = deadline;
+		try {
+			if (this->work(new_deadline)) {
+				this->set_deadline(new_deadline);
+			}
+		}
+		catch (...) {
+		}
+	}
+
+};
+
+
+} // namespace linux
@@ -0,0 +1,201 @@
+#include "linux_uring.h"
+
+#include <cstring>
+#include <system_error>
+
+#include <sys/syscall.h>
+
+
+namespace linux {
+
+
+static int io_uring_setup(unsigned entries, struct io_uring_params *params) {
+	int ret;
+	if (_unlikely((ret = static_cast<int>(::syscall(SYS_io_uring_setup, entries, params))) < 0)) {
+		throw std::system_error(errno, std::system_category(), "io_uring_setup");
+	}
+	return ret;
+}
+
+static void io_uring_register(int fd, unsigned opcode, const void *arg, unsigned nr_args) {
+	if (_unlikely(::syscall(SYS_io_uring_register, fd, opcode, arg, nr_args) < 0)) {
+		throw std::system_error(errno, std::system_category(), "io_uring_register");
+	}
+}
+
+template <typename T>
+static inline T * _pure offset(const FileDescriptor::MemoryMapping &mapping, __u32 off) noexcept {
+	return reinterpret_cast<T *>(static_cast<std::byte *>(mapping.data()) + off);
+}
+
+
+IOURing::IOURing(unsigned entries, unsigned flags, unsigned sq_thread_idle) : sq_tail(), setup_flags(flags), features() {
+	struct io_uring_params params { };
+	params.flags = flags;
+	params.sq_thread_idle = sq_thread_idle;
+	fd = FileDescriptor(io_uring_setup(entries, &params));
+	features = params.features;
+	sq_mapping = fd.mmap(IORING_OFF_SQ_RING, params.sq_off.array + params.sq_entries * sizeof(unsigned), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE);
+	cq_mapping = fd.mmap(IORING_OFF_CQ_RING, params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE);
+	sqe_mapping = fd.mmap(IORING_OFF_SQES, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE);
+	sq_khead = offset<unsigned>(sq_mapping, params.sq_off.head);
+	sq_ktail = offset<unsigned>(sq_mapping, params.sq_off.tail);
+	sq_kflags = offset<unsigned>(sq_mapping, params.sq_off.flags);
+	sq_array = offset<unsigned>(sq_mapping, params.sq_off.array);
+	sq_mask = *offset<unsigned>(sq_mapping, params.sq_off.ring_mask);
+	sq_entries = *offset<unsigned>(sq_mapping, params.sq_off.ring_entries);
+	sq_tail = *sq_ktail;
+	cq_khead = offset<unsigned>(cq_mapping, params.cq_off.head);
+	cq_ktail = offset<unsigned>(cq_mapping, params.cq_off.tail);
+	cq_mask = *offset<unsigned>(cq_mapping, params.cq_off.ring_mask);
+	sqes = static_cast<struct io_uring_sqe *>(sqe_mapping.data());
+	cqes = offset<struct io_uring_cqe>(cq_mapping, params.cq_off.cqes);
+}
+
+struct io_uring_sqe * IOURing::get_sqe() noexcept {
+	if (_unlikely(this->pending() >= sq_entries)) {
+		return nullptr;
+	}
+	unsigned index = sq_tail++ & sq_mask;
+	sq_array[index] = index;
+	struct io_uring_sqe *sqe = &sqes[index];
+	std::memset(sqe, 0, sizeof *sqe);
+	return sqe;
+}
+
+void IOURing::register_buffers(std::span<const struct iovec> buffers) {
+	io_uring_register(fd, IORING_REGISTER_BUFFERS, buffers.data(), static_cast<unsigned>(buffers.size()));
+}
+
+void IOURing::unregister_buffers() {
+	io_uring_register(fd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+}
+
+void IOURing::register_files(std::span<const int> fds) {
+	io_uring_register(fd, IORING_REGISTER_FILES, fds.data(), static_cast<unsigned>(fds.size()));
+}
+
+void IOURing::unregister_files() {
+	io_uring_register(fd, IORING_UNREGISTER_FILES, nullptr, 0);
+}
+
+struct io_uring_sqe * IOURing::prep(__u8 opcode, int fd, const void *addr, unsigned len, off_t offset, uint64_t user_data, unsigned sqe_flags) noexcept {
+	struct io_uring_sqe *sqe = this->get_sqe();
+	if (_likely(sqe)) {
+		sqe->opcode = opcode;
+		sqe->flags = static_cast<__u8>(sqe_flags);
+		sqe->fd = fd;
+		sqe->addr = reinterpret_cast<uintptr_t>(addr);
+		sqe->len = len;
+		sqe->off = static_cast<__u64>(offset);
+		sqe->user_data = user_data;
+	}
+	return sqe;
+}
+
+struct io_uring_sqe * IOURing::read_fixed(int fd, void *buf, unsigned nbytes, off_t offset, unsigned buf_index, uint64_t user_data, unsigned sqe_flags) noexcept {
+	struct io_uring_sqe *sqe = this->prep(IORING_OP_READ_FIXED, fd, buf, nbytes, offset, user_data, sqe_flags);
+	if (_likely(sqe)) {
+		sqe->buf_index = static_cast<__u16>(buf_index);
+	}
+	return sqe;
+}
+
+struct io_uring_sqe * IOURing::write_fixed(int fd, const void *buf, unsigned nbytes, off_t offset, unsigned buf_index, uint64_t user_data, unsigned sqe_flags) noexcept {
+	struct io_uring_sqe *sqe = this->prep(IORING_OP_WRITE_FIXED, fd, buf, nbytes, offset, user_data, sqe_flags);
+	if (_likely(sqe)) {
+		sqe->buf_index = static_cast<__u16>(buf_index);
+	}
+	return sqe;
+}
+
+struct io_uring_sqe * IOURing::fsync(int fd, uint64_t user_data, unsigned fsync_flags, unsigned sqe_flags) noexcept {
+	struct io_uring_sqe *sqe = this->prep(IORING_OP_FSYNC, fd, nullptr, 0, 0, user_data, sqe_flags);
+	if (_likely(sqe)) {
+		sqe->fsync_flags = fsync_flags;
+	}
+	return sqe;
+}
+
+unsigned IOURing::submit(unsigned min_complete, const struct timespec *timeout, const sigset_t *sigmask) {
+	__atomic_store_n(sq_ktail, sq_tail, __ATOMIC_RELEASE);
+	unsigned to_submit = this->pending(), flags = 0;
+	if (setup_flags & IORING_SETUP_SQPOLL) {
+		// the polling thread picks up new entries by itself unless it has gone to sleep
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		if (__atomic_load_n(sq_kflags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP) {
+			flags |= IORING_ENTER_SQ_WAKEUP;
+		}
+		else if (min_complete == 0) {
+			return to_submit;
+		}
+	}
+	return this->enter(to_submit, min_complete, flags, timeout, sigmask);
+}
+
+void IOURing::wait(unsigned min_complete, const struct timespec *timeout, const sigset_t *sigmask) {
+	this->enter(0, min_complete, 0, timeout, sigmask);
+}
+
+unsigned IOURing::enter(unsigned to_submit, unsigned min_complete, unsigned flags, const struct timespec *timeout, const sigset_t *sigmask) {
+	struct io_uring_getevents_arg arg { };
+	if (min_complete) {
+		flags |= IORING_ENTER_GETEVENTS;
+		if (timeout) {
+			arg.ts = reinterpret_cast<uintptr_t>(timeout);
+			arg.sigmask = reinterpret_cast<uintptr_t>(sigmask);
+			arg.sigmask_sz = _NSIG / 8;
+			flags |= IORING_ENTER_EXT_ARG;
+		}
+	}
+	else if (to_submit == 0 && !flags) {
+		return 0;
+	}
+	int ret;
+	if (flags & IORING_ENTER_EXT_ARG) {
+		ret = static_cast<int>(::syscall(SYS_io_uring_enter, static_cast<int>(fd), to_submit, min_complete, flags, &arg, sizeof arg));
+	}
+	else {
+		ret = static_cast<int>(::syscall(SYS_io_uring_enter, static_cast<int>(fd), to_submit, min_complete, flags, sigmask, _NSIG / 8));
+	}
+	if (ret < 0) {
+		if (_unlikely(errno != EINTR && errno != ETIME && errno != EBUSY)) {
+			throw std::system_error(errno, std::system_category(), "io_uring_enter");
+		}
+		return 0;
+	}
+	return static_cast<unsigned>(ret);
+}
+
+const struct io_uring_cqe * IOURing::peek() const noexcept {
+	unsigned head = *cq_khead;
+	return head == __atomic_load_n(cq_ktail, __ATOMIC_ACQUIRE) ? nullptr : &cqes[head & cq_mask];
+}
+
+size_t IOURing::submit(std::span<const struct io_uring_sqe> entries) {
+	size_t n = 0;
+	for (struct io_uring_sqe *sqe; n < entries.size() && (sqe = this->get_sqe()); ++n) {
+		*sqe = entries[n];
+	}
+	this->submit();
+	return n;
+}
+
+size_t IOURing::getevents(size_t min_nr, std::span<struct io_uring_cqe> events, const struct timespec *timeout) {
+	size_t n = 0;
+	for (;;) {
+		for (const struct io_uring_cqe *cqe; n < events.size() && (cqe = this->peek()); this->advance()) {
+			events[n++] = *cqe;
+		}
+		if (n >= min_nr || n >= events.size()) {
+			return n;
+		}
+		this->submit(static_cast<unsigned>(min_nr - n), timeout);
+		if (!this->peek()) {
+			return n;
+		}
+	}
+}
+
+
+} // namespace linux
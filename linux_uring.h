@@ -0,0 +1,84 @@
+#pragma once
+
+#include <csignal>
+#include <cstdint>
+
+#include <linux/io_uring.h>
+#include <sys/uio.h>
+
+#include "compiler.h"
+#include "fd.h"
+#include "span.h"
+
+
+#undef linux
+namespace linux {
+
+
+// An io_uring instance. The operation helpers below take and fill a submission queue entry, returning
+// nullptr if the queue is full; sqe_flags may include IOSQE_FIXED_FILE, in which case fd is an index
+// into the registered files, and IOSQE_IO_LINK, to start the next entry only once this one succeeds.
+// With IORING_SETUP_SQPOLL in flags, a kernel thread polls the submission queue, sleeping after
+// sq_thread_idle milliseconds without work, and submit() makes a system call only to wake it or to wait.
+class IOURing {
+
+private:
+	FileDescriptor fd;
+	FileDescriptor::MemoryMapping sq_mapping, cq_mapping, sqe_mapping;
+	unsigned *sq_khead, *sq_ktail, *sq_kflags, *sq_array, sq_mask, sq_entries, sq_tail;
+	unsigned *cq_khead, *cq_ktail, cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	unsigned setup_flags, features;
+
+public:
+	explicit IOURing(unsigned entries, unsigned flags = 0, unsigned sq_thread_idle = 0);
+
+public:
+	_pure operator int () const noexcept { return fd; }
+	unsigned _pure get_features() const noexcept { return features; }
+
+	// registers buffers for the *_fixed operations, which name them by index
+	void register_buffers(std::span<const struct iovec> buffers);
+	void unregister_buffers();
+	// registers files for entries flagged IOSQE_FIXED_FILE, which name them by index
+	void register_files(std::span<const int> fds);
+	void unregister_files();
+
+	struct io_uring_sqe * read(int fd, void *buf, unsigned nbytes, off_t offset, uint64_t user_data, unsigned sqe_flags = 0) noexcept { return this->prep(IORING_OP_READ, fd, buf, nbytes, offset, user_data, sqe_flags); }
+	struct io_uring_sqe * write(int fd, const void *buf, unsigned nbytes, off_t offset, uint64_t user_data, unsigned sqe_flags = 0) noexcept { return this->prep(IORING_OP_WRITE, fd, buf, nbytes, offset, user_data, sqe_flags); }
+	struct io_uring_sqe * readv(int fd, const struct iovec iov[], unsigned iovcnt, off_t offset, uint64_t user_data, unsigned sqe_flags = 0) noexcept { return this->prep(IORING_OP_READV, fd, iov, iovcnt, offset, user_data, sqe_flags); }
+	struct io_uring_sqe * writev(int fd, const struct iovec iov[], unsigned iovcnt, off_t offset, uint64_t user_data, unsigned sqe_flags = 0) noexcept { return this->prep(IORING_OP_WRITEV, fd, iov, iovcnt, offset, user_data, sqe_flags); }
+	struct io_uring_sqe * read_fixed(int fd, void *buf, unsigned nbytes, off_t offset, unsigned buf_index, uint64_t user_data, unsigned sqe_flags = 0) noexcept;
+	struct io_uring_sqe * write_fixed(int fd, const void *buf, unsigned nbytes, off_t offset, unsigned buf_index, uint64_t user_data, unsigned sqe_flags = 0) noexcept;
+	// fsync_flags may be IORING_FSYNC_DATASYNC
+	struct io_uring_sqe * fsync(int fd, uint64_t user_data, unsigned fsync_flags = 0, unsigned sqe_flags = 0) noexcept;
+
+	// returns a zeroed submission queue entry, or nullptr if the submission queue is full
+	_nodiscard struct io_uring_sqe * get_sqe() noexcept;
+	unsigned _pure capacity() const noexcept { return sq_entries; }
+	unsigned _pure pending() const noexcept { return sq_tail - __atomic_load_n(sq_khead, __ATOMIC_ACQUIRE); }
+
+	// submits all pending entries and, if min_complete is non-zero, waits for that many completions;
+	// returns the number of entries submitted, or zero if interrupted or timed out
+	unsigned submit(unsigned min_complete = 0, const struct timespec *timeout = nullptr, const sigset_t *sigmask = nullptr);
+	// waits for min_complete completions without submitting, so that other threads may prepare entries meanwhile
+	void wait(unsigned min_complete, const struct timespec *timeout = nullptr, const sigset_t *sigmask = nullptr);
+
+	// queues copies of prepared entries, as many as fit, and submits them; returns the number queued
+	size_t submit(std::span<const struct io_uring_sqe> entries);
+
+	// returns the next completion queue entry without consuming it, or nullptr if there is none
+	_nodiscard const struct io_uring_cqe * peek() const noexcept;
+	void advance(unsigned n = 1) noexcept { __atomic_store_n(cq_khead, *cq_khead + n, __ATOMIC_RELEASE); }
+
+	size_t getevents(size_t min_nr, std::span<struct io_uring_cqe> events, const struct timespec *timeout = nullptr);
+
+private:
+	unsigned enter(unsigned to_submit, unsigned min_complete, unsigned flags, const struct timespec *timeout, const sigset_t *sigmask);
+	struct io_uring_sqe * prep(__u8 opcode, int fd, const void *addr, unsigned len, off_t offset, uint64_t user_data, unsigned sqe_flags) noexcept;
+
+};
+
+
+} // namespace linux
@@ -1,5 +1,4 @@
 #include <atomic>
-#include <functional>
 
 #include "scheduler.h"
 
@@ -18,9 +17,15 @@ private:
 	std::atomic<scheduler_t *> scheduler;
 	std::atomic<typename time_point_t::rep> deadline;
 	std::atomic_flag running;
+	// guards task and task_seq: schedule_task may run on the caller's, the scheduler's and the executor's
+	// threads at once, and must compare sequence numbers and swap handles in one step so that the task it
+	// cancels is always the older; held only for that, so seldom contended
+	mutex_t task_mutex;
+	unsigned long task_seq;
+	typename scheduler_t::Handle task;
 
 protected:
-	Periodic() : sched_seq(0), exec_seq(0), scheduler(nullptr), deadline(clock_t::now().time_since_epoch().count()), running(ATOMIC_FLAG_INIT) { }
+	Periodic() : sched_seq(0), exec_seq(0), scheduler(nullptr), deadline(clock_t::now().time_since_epoch().count()), running(ATOMIC_FLAG_INIT), task_seq(0) { }
 	explicit Periodic(scheduler_t *scheduler, time_point_t deadline = clock_t::now());
 
 public:
@@ -36,6 +41,8 @@ protected:
 	virtual bool work(time_point_t &deadline) = 0;
 
 private:
-	std::function<void (void) /* noexcept */> make_task(unsigned long seq);
+	void schedule_task(scheduler_t *scheduler, time_point_t deadline, unsigned long seq);
+	typename scheduler_t::task_t make_task(unsigned long seq);
+	void execute(unsigned long seq, time_point_t deadline);
 
 };
@@ -4,9 +4,9 @@
 
 
 template <typename Clock>
-Periodic<Clock>::Periodic(scheduler_t *scheduler, time_point_t deadline) : sched_seq(1), exec_seq(0), scheduler(scheduler), deadline(deadline.time_since_epoch().count()), running(ATOMIC_FLAG_INIT) {
+Periodic<Clock>::Periodic(scheduler_t *scheduler, time_point_t deadline) : sched_seq(1), exec_seq(0), scheduler(scheduler), deadline(deadline.time_since_epoch().count()), running(ATOMIC_FLAG_INIT), task_seq(0) {
 	if (scheduler) {
-		scheduler->call_at(deadline, this->make_task(1));
+		this->schedule_task(scheduler, deadline, 1);
 	}
 }
 
@@ -17,7 +17,7 @@ bool Periodic<Clock>::set_scheduler(scheduler_t *scheduler) {
 		unsigned long seq = ++sched_seq;
 		if (this->scheduler.compare_exchange_weak(old_scheduler, scheduler)) {
 			if (scheduler) {
-				scheduler->call_at(this->get_deadline(), this->make_task(seq));
+				this->schedule_task(scheduler, this->get_deadline(), seq);
 			}
 			return true;
 		}
@@ -35,7 +35,7 @@ bool Periodic<Clock>::set_deadline(time_point_t deadline) {
 			if (this->deadline.compare_exchange_weak(old_deadline_rep, deadline_rep)) {
 				scheduler_t *scheduler = this->scheduler;
 				if (scheduler) {
-					scheduler->call_at(deadline, this->make_task(seq));
+					this->schedule_task(scheduler, deadline, seq);
 				}
 				return true;
 			}
@@ -68,7 +68,7 @@ bool Periodic<Clock>::schedule(scheduler_t *scheduler, time_point_t deadline) {
 			unsigned long seq = ++sched_seq;
 			if (this->scheduler.compare_exchange_weak(old_scheduler, scheduler) && this->deadline.compare_exchange_weak(old_deadline_rep, deadline_rep)) {
 				if (scheduler) {
-					scheduler->call_at(deadline, this->make_task(seq));
+					this->schedule_task(scheduler, deadline, seq);
 				}
 				return true;
 			}
@@ -85,33 +85,56 @@ bool Periodic<Clock>::schedule(scheduler_t *scheduler, time_point_t deadline) {
 }
 
 template <typename Clock>
-std::function<void (void) /* noexcept */> Periodic<Clock>::make_task(unsigned long seq) {
+void Periodic<Clock>::schedule_task(scheduler_t *scheduler, time_point_t deadline, unsigned long seq) {
+	typename scheduler_t::Handle handle = scheduler->call_at(deadline, this->make_task(seq));
+	{
+		std::lock_guard<mutex_t> lock(task_mutex);
+		if (seq >= task_seq) {
+			task_seq = seq;
+			task.swap(handle);
+		}
+	}
+	// whichever task is older can only be stale now, so take it out of its scheduler
+	handle.cancel();
+}
+
+template <typename Clock>
+typename Periodic<Clock>::scheduler_t::task_t Periodic<Clock>::make_task(unsigned long seq) {
 	return [this, seq]() noexcept {
 		if (sched_seq == seq) {
 			scheduler_t *scheduler = this->scheduler;
 			time_point_t deadline = this->get_deadline();
 			if (sched_seq == seq) {
 				if (deadline > clock_t::now()) {
-					scheduler->call_at(deadline, this->make_task(seq));
+					this->schedule_task(scheduler, deadline, seq);
 				}
 				else if (!running.test_and_set()) {
 					exec_seq = seq;
-					std::thread([this, seq, scheduler, deadline]() {
-						time_point_t new_deadline = deadline;
-						bool reschedule;
-						try {
-							reschedule = this->work(new_deadline);
-						}
-						catch (...) {
-							reschedule = false;
-						}
-						if (reschedule && sched_seq == seq) {
-							this->set_deadline(new_deadline);
-						}
-						running.clear();
-					}).detach();
+					if (scheduler->get_executor()) {
+						// already on one of the executor's workers
+						this->execute(seq, deadline);
+					}
+					else {
+						std::thread(&Periodic::execute, this, seq, deadline).detach();
+					}
 				}
 			}
 		}
 	};
 }
+
+template <typename Clock>
+void Periodic<Clock>::execute(unsigned long seq, time_point_t deadline) {
+	time_point_t new_deadline = deadline;
+	bool reschedule;
+	try {
+		reschedule = this->work(new_deadline);
+	}
+	catch (...) {
+		reschedule = false;
+	}
+	if (reschedule && sched_seq == seq) {
+		this->set_deadline(new_deadline);
+	}
+	running.clear();
+}
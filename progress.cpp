@@ -74,13 +74,13 @@ ProgressBar::~ProgressBar() {
 }
 
 void ProgressBar::update(uint_least64_t delta) {
-	std::lock_guard<std::mutex> lock(mutex);
+	std::lock_guard<mutex_t> lock(mutex);
 	pos += delta;
 	this->delta += delta;
 }
 
 void ProgressBar::display() {
-	std::unique_lock<std::mutex> lock(mutex);
+	std::unique_lock<mutex_t> lock(mutex);
 	while (!finished) {
 		condition.wait_for(lock, std::chrono::seconds(1));
 		delta >>= 1;
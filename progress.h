@@ -1,12 +1,12 @@
-#include <condition_variable>
-#include <mutex>
 #include <thread>
 
+#include "sync.h"
+
 class ProgressBar {
 
 private:
-	std::mutex mutex;
-	std::condition_variable condition;
+	mutex_t mutex;
+	condition_variable_t condition;
 	uint_least64_t pos, size, delta;
 	volatile bool finished;
 	std::thread display_thread;
@@ -0,0 +1,71 @@
+#include "rcu.h"
+
+#include <mutex>
+
+
+RcuDomain::Reader::Reader(RcuDomain &domain) : state(), nesting(), domain(domain) {
+	std::lock_guard<linux::FutexMutex> lock(domain.readers_mutex);
+	next = domain.readers, domain.readers = this;
+}
+
+RcuDomain::Reader::~Reader() {
+	std::lock_guard<linux::FutexMutex> lock(domain.readers_mutex);
+	for (Reader **link = &domain.readers; *link; link = &(*link)->next) {
+		if (*link == this) {
+			*link = next;
+			break;
+		}
+	}
+}
+
+
+RcuDomain::~RcuDomain() {
+	this->reclaim();
+}
+
+void RcuDomain::synchronize() {
+	// a reader that observes the new epoch also observes everything published before it
+	int target = __atomic_add_fetch(&epoch, 1, __ATOMIC_SEQ_CST) << 2;
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	std::lock_guard<linux::FutexMutex> lock(readers_mutex);
+	for (Reader *reader = readers; reader; reader = reader->next) {
+		for (unsigned spins = 0;;) {
+			int s = __atomic_load_n(&reader->state, __ATOMIC_ACQUIRE);
+			// a reader that entered in our epoch or a later one, which concurrent calls may have begun, started
+			// after we published; compare by wrapping difference, as the epoch may overflow
+			if (!(s & 1) || static_cast<int>(static_cast<unsigned>(s & ~3) - static_cast<unsigned>(target)) >= 0) {
+				break;
+			}
+			if (spins < linux::FutexMutex::spin_limit) {
+				++spins, _cpu_relax();
+			}
+			else if ((s & 2) || __atomic_compare_exchange_n(&reader->state, &s, s | 2, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				linux::futex_wait(&reader->state, s | 2);
+			}
+		}
+	}
+}
+
+void RcuDomain::retire(void *ptr, void (*deleter)(void *)) {
+	Retired *node = new Retired { nullptr, ptr, deleter };
+	node->next = retired.load(std::memory_order_relaxed);
+	while (!retired.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed));
+	if (retired_count.fetch_add(1, std::memory_order_relaxed) + 1 >= retire_batch) {
+		this->reclaim();
+	}
+}
+
+void RcuDomain::reclaim() {
+	Retired *node = retired.exchange(nullptr, std::memory_order_acquire);
+	if (!node) {
+		return;
+	}
+	this->synchronize();
+	unsigned n = 0;
+	do {
+		Retired *next = node->next;
+		node->deleter(node->ptr);
+		delete node, node = next, ++n;
+	} while (node);
+	retired_count.fetch_sub(n, std::memory_order_relaxed);
+}
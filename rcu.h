@@ -0,0 +1,153 @@
+#pragma once
+
+#include <atomic>
+#include <climits>
+#include <cstddef>
+
+#include "compiler.h"
+#include "linux_sync.h"
+
+
+// Epoch-based read-copy-update. Each reading thread registers a Reader, which occupies a cache line of
+// its own; entering and leaving a read-side critical section touches only that line, so readers never
+// contend with one another. synchronize() advances the epoch and waits, sleeping on each straggling
+// Reader's futex word, until every critical section that began before it has ended. retire() defers
+// freeing an object until then, in batches, so that writers seldom have to wait at all.
+class RcuDomain {
+
+public:
+	static constexpr size_t cache_line = 64;
+	static constexpr unsigned retire_batch = 64;
+
+	class Reader;
+
+	// a read-side critical section; nests
+	class ReadLock {
+
+	private:
+		Reader *reader;
+
+	public:
+		explicit ReadLock(Reader &reader) noexcept : reader(&reader) { reader.lock(); }
+		~ReadLock() { reader->unlock(); }
+
+	private:
+		ReadLock(const ReadLock &) = delete;
+		ReadLock & operator=(const ReadLock &) = delete;
+
+	};
+
+	// a reading thread's registration; must be used only by the thread that owns it
+	class alignas(cache_line) Reader {
+		friend class RcuDomain;
+
+	private:
+		// the epoch in which the current critical section began, shifted left by two, or zero when idle;
+		// bit 0 marks an active critical section and bit 1 a writer that may be sleeping on it
+		int state;
+		unsigned nesting;
+		RcuDomain &domain;
+		Reader *next;
+
+	public:
+		explicit Reader(RcuDomain &domain);
+		~Reader();
+
+	private:
+		Reader(const Reader &) = delete;
+		Reader & operator=(const Reader &) = delete;
+
+	public:
+		void lock() noexcept {
+			if (nesting++ == 0) {
+				__atomic_store_n(&state, __atomic_load_n(&domain.epoch, __ATOMIC_ACQUIRE) << 2 | 1, __ATOMIC_RELAXED);
+				// order our announcement before any loads of protected pointers, against synchronize()
+				__atomic_thread_fence(__ATOMIC_SEQ_CST);
+			}
+		}
+
+		void unlock() {
+			if (--nesting == 0 && _unlikely(__atomic_exchange_n(&state, 0, __ATOMIC_RELEASE) & 2)) {
+				linux::futex_wake(&state, INT_MAX);
+			}
+		}
+
+	};
+
+private:
+	struct Retired {
+		Retired *next;
+		void *ptr;
+		void (*deleter)(void *);
+	};
+
+private:
+	alignas(cache_line) int epoch;
+	alignas(cache_line) std::atomic<Retired *> retired;
+	std::atomic<unsigned> retired_count;
+	linux::FutexMutex readers_mutex;
+	Reader *readers;
+
+public:
+	RcuDomain() noexcept : epoch(1), retired(), retired_count(), readers() { }
+	~RcuDomain();
+
+private:
+	RcuDomain(const RcuDomain &) = delete;
+	RcuDomain & operator=(const RcuDomain &) = delete;
+
+public:
+	// waits until every read-side critical section in progress at the time of the call has ended;
+	// neither this nor retire() may be called from inside a critical section
+	void synchronize();
+
+	// frees ptr with deleter once no reader can still hold it
+	void retire(void *ptr, void (*deleter)(void *));
+
+	template <typename T>
+	void retire(T *ptr) {
+		this->retire(ptr, [](void *p) { delete static_cast<T *>(p); });
+	}
+
+	// frees everything retired so far, waiting for readers if need be
+	void reclaim();
+
+};
+
+
+// A pointer to an immutable T that readers load inside a read-side critical section and that writers
+// replace wholesale, retiring the old object to the domain.
+template <typename T>
+class RcuPointer {
+
+private:
+	alignas(RcuDomain::cache_line) std::atomic<T *> ptr;
+	RcuDomain &domain;
+
+public:
+	explicit RcuPointer(RcuDomain &domain, T *initial = nullptr) noexcept : ptr(initial), domain(domain) { }
+
+	~RcuPointer() {
+		if (T *p = ptr.load(std::memory_order_relaxed)) {
+			domain.retire(p);
+		}
+	}
+
+private:
+	RcuPointer(const RcuPointer &) = delete;
+	RcuPointer & operator=(const RcuPointer &) = delete;
+
+public:
+	_nodiscard T * load(const RcuDomain::ReadLock &) const noexcept { return ptr.load(std::memory_order_acquire); }
+
+	// publishes replacement and retires the object it replaced
+	void store(T *replacement) {
+		if (T *old = this->exchange(replacement)) {
+			domain.retire(old);
+		}
+	}
+
+	// publishes replacement and returns the object it replaced, which the caller may free only after synchronize()
+	_nodiscard T * exchange(T *replacement) noexcept { return ptr.exchange(replacement, std::memory_order_acq_rel); }
+
+};
@@ -0,0 +1,45 @@
+#include "reactorstats.h"
+
+#include <algorithm>
+
+
+auto ReactorStats::Snapshot::operator+=(const Snapshot &other) -> Snapshot & {
+	dispatch_ns += other.dispatch_ns;
+	events_per_wakeup += other.events_per_wakeup;
+	idle_ns += other.idle_ns;
+	slow_dispatches += other.slow_dispatches;
+	outliers.insert(outliers.end(), other.outliers.begin(), other.outliers.end());
+	return *this;
+}
+
+void ReactorStats::record_outlier(const std::type_info &type, const void *selectable, std::chrono::nanoseconds elapsed) noexcept {
+	uint64_t n = slow_dispatches.load(std::memory_order_relaxed);
+	OutlierSlot &slot = outliers[n % max_outliers];
+	unsigned seq = slot.seq.load(std::memory_order_relaxed);
+	slot.seq.store(seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.type.store(&type, std::memory_order_relaxed);
+	slot.selectable.store(selectable, std::memory_order_relaxed);
+	slot.elapsed.store(elapsed.count(), std::memory_order_relaxed);
+	slot.seq.store(seq + 2, std::memory_order_release);
+	slow_dispatches.store(n + 1, std::memory_order_release);
+}
+
+auto ReactorStats::snapshot() const -> Snapshot {
+	Snapshot snapshot { dispatch_ns.snapshot(), events_per_wakeup.snapshot(), idle_ns.snapshot(), slow_dispatches.load(std::memory_order_acquire), { } };
+	size_t n = static_cast<size_t>(std::min<uint64_t>(snapshot.slow_dispatches, max_outliers));
+	snapshot.outliers.reserve(n);
+	for (size_t i = 1; i <= n; ++i) {
+		const OutlierSlot &slot = outliers[(snapshot.slow_dispatches - i) % max_outliers];
+		for (;;) {
+			unsigned seq = slot.seq.load(std::memory_order_acquire);
+			Outlier outlier { slot.type.load(std::memory_order_relaxed), slot.selectable.load(std::memory_order_relaxed), std::chrono::nanoseconds(slot.elapsed.load(std::memory_order_relaxed)) };
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (!(seq & 1) && slot.seq.load(std::memory_order_relaxed) == seq) {
+				snapshot.outliers.push_back(outlier);
+				break;
+			}
+		}
+	}
+	return snapshot;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <typeinfo>
+#include <vector>
+
+#include "histogram.h"
+
+
+// Loop statistics for one reactor thread, fed by the instrumented Selectable::pump overloads.
+// Only the pumping thread may record; any thread may take a snapshot at any time.
+class ReactorStats {
+
+public:
+	static constexpr size_t max_outliers = 16;
+
+	struct Outlier {
+		const std::type_info *type; // dynamic type of the slow Selectable
+		const void *selectable;
+		std::chrono::nanoseconds elapsed;
+	};
+
+	struct Snapshot {
+		Histogram::Snapshot dispatch_ns; // time spent in each Selectable::selected call
+		Histogram::Snapshot events_per_wakeup;
+		Histogram::Snapshot idle_ns; // time spent waiting in Selector::select
+		uint64_t slow_dispatches;
+		std::vector<Outlier> outliers; // up to max_outliers of the most recent slow dispatches, newest first
+
+		Snapshot & operator+=(const Snapshot &other);
+	};
+
+private:
+	struct OutlierSlot {
+		std::atomic<unsigned> seq;
+		std::atomic<const std::type_info *> type;
+		std::atomic<const void *> selectable;
+		std::atomic<std::chrono::nanoseconds::rep> elapsed;
+	};
+
+	const std::chrono::nanoseconds slow_threshold;
+	Histogram dispatch_ns, events_per_wakeup, idle_ns;
+	std::atomic<uint64_t> slow_dispatches;
+	std::array<OutlierSlot, max_outliers> outliers;
+
+public:
+	// dispatches taking at least slow_threshold are counted and remembered as outliers
+	explicit ReactorStats(std::chrono::nanoseconds slow_threshold = std::chrono::milliseconds(1)) noexcept :
+			slow_threshold(slow_threshold), slow_dispatches(), outliers() { }
+
+private:
+	ReactorStats(const ReactorStats &) = delete;
+	ReactorStats & operator=(const ReactorStats &) = delete;
+
+public:
+	void record_wakeup(std::chrono::nanoseconds idle, size_t events) noexcept {
+		idle_ns.record(static_cast<uint64_t>(idle.count())), events_per_wakeup.record(events);
+	}
+
+	// takes the type up front, as the Selectable may have destroyed itself by the time this is called
+	void record_dispatch(const std::type_info &type, const void *selectable, std::chrono::nanoseconds elapsed) noexcept {
+		dispatch_ns.record(static_cast<uint64_t>(elapsed.count()));
+		if (_unlikely(elapsed >= slow_threshold)) {
+			this->record_outlier(type, selectable, elapsed);
+		}
+	}
+
+	Snapshot snapshot() const;
+
+private:
+	void record_outlier(const std::type_info &type, const void *selectable, std::chrono::nanoseconds elapsed) noexcept;
+
+};
@@ -0,0 +1,29 @@
+#include "ringbuffer.h"
+
+#include <algorithm>
+#include <system_error>
+
+#include "fd.h"
+
+
+RingBuffer::RingBuffer(size_t capacity) {
+	size_t page_size = ::sysconf(_SC_PAGESIZE);
+	capacity = (std::max<size_t>(capacity, 1) + page_size - 1) & ~(page_size - 1);
+	FileDescriptor memfd(linux::memfd_create("RingBuffer"));
+	memfd.ftruncate(static_cast<off_t>(capacity));
+	// reserve twice the address space, then map the same pages into both halves
+	base = static_cast<std::byte *>(posix::mmap(nullptr, capacity * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+	if (_unlikely(::mmap(base, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, memfd, 0) == MAP_FAILED ||
+			::mmap(base + capacity, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, memfd, 0) == MAP_FAILED)) {
+		int error = errno;
+		::munmap(base, capacity * 2);
+		throw std::system_error(error, std::system_category(), "mmap");
+	}
+	eptr = (pptr = gptr = bptr = base) + capacity;
+}
+
+RingBuffer::~RingBuffer() {
+	if (base) {
+		::munmap(base, this->capacity() * 2);
+	}
+}
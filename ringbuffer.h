@@ -0,0 +1,48 @@
+#pragma once
+
+#include <utility>
+
+#include "buffer.h"
+#include "compiler.h"
+
+
+// A BufferView over a ring of memory that is mapped twice, back to back, so that both the readable and
+// the writable regions are always contiguous, however they straddle the end of the ring. The view keeps
+// its usual meaning, with size() equal to the capacity throughout, but compact() merely slides the view
+// forward to begin at gptr, without copying anything. The capacity is rounded up to a whole number of pages.
+// compact() and clear() hide BufferView's rather than override them, as those are not virtual, so code that
+// is handed a RingBuffer as a BufferView & still compacts correctly, but by copying; pass it as a RingBuffer
+// where that matters.
+class RingBuffer : public BufferView {
+
+private:
+	std::byte *base;
+
+public:
+	RingBuffer() noexcept : base() { }
+	explicit RingBuffer(size_t capacity);
+	RingBuffer(RingBuffer &&move) noexcept : BufferView(std::exchange(static_cast<BufferView &>(move), { })), base(std::exchange(move.base, nullptr)) { }
+	RingBuffer & operator=(RingBuffer &&move) noexcept { return this->swap(move), *this; }
+	~RingBuffer();
+	void swap(RingBuffer &other) noexcept { using std::swap; swap(static_cast<BufferView &>(*this), static_cast<BufferView &>(other)), swap(base, other.base); }
+	friend void swap(RingBuffer &lhs, RingBuffer &rhs) noexcept { lhs.swap(rhs); }
+
+private:
+	RingBuffer(const RingBuffer &) = delete;
+	RingBuffer & operator=(const RingBuffer &) = delete;
+
+public:
+	size_t _pure capacity() const noexcept { return this->size(); }
+
+	void clear() noexcept { eptr = (pptr = gptr = bptr = base) + this->capacity(); }
+
+	void compact() noexcept {
+		size_t capacity = this->capacity();
+		if (gptr >= base + capacity) {
+			// keep the view within the first lap so that its end never passes the second mapping
+			gptr -= capacity, pptr -= capacity;
+		}
+		eptr = (bptr = gptr) + capacity;
+	}
+
+};
@@ -0,0 +1,8 @@
+#include "ringqueue.h"
+
+
+void _RingQueue::unpark_slow(unsigned kind, size_t n) {
+	// a waiter that has read the sequence but not yet gone to sleep will find that it has changed
+	__atomic_add_fetch(&seq, 1, __ATOMIC_SEQ_CST);
+	linux::futex_wake_bitset(&seq, static_cast<int>(std::min<size_t>(n, INT_MAX)), 1u << kind);
+}
@@ -0,0 +1,363 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+
+#include "bit.h"
+#include "compiler.h"
+#include "linux_futex.h"
+#include "span.h"
+
+
+// The parking lot shared by both kinds of RingQueue: a futex word holding a sequence number, which a waker
+// bumps before waking anyone so that a waiter about to sleep notices, and counts of the consumers and
+// producers that may be asleep, so that making progress costs no system call while there are none.
+// Consumers and producers wait with different bitset masks, so a push wakes only consumers and a pop only
+// producers.
+class _RingQueue {
+
+public:
+	static constexpr size_t cache_line = 64;
+
+protected:
+	static constexpr unsigned consumers = 0, producers = 1;
+
+private:
+	alignas(cache_line) int seq;
+	unsigned waiting[2];
+
+protected:
+	_RingQueue() noexcept : seq(), waiting() { }
+
+	// sleeps as a waiter of the given kind unless ready() is already true
+	template <typename Ready>
+	void park(unsigned kind, Ready &&ready) {
+		__atomic_add_fetch(&waiting[kind], 1, __ATOMIC_SEQ_CST);
+		int v = __atomic_load_n(&seq, __ATOMIC_SEQ_CST);
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		if (!ready()) {
+			linux::futex_wait_bitset(&seq, v, 1u << kind);
+		}
+		__atomic_sub_fetch(&waiting[kind], 1, __ATOMIC_RELAXED);
+	}
+
+	// wakes up to n waiters of the given kind, after making progress that they may be waiting for
+	void unpark(unsigned kind, size_t n) {
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		if (_unlikely(__atomic_load_n(&waiting[kind], __ATOMIC_RELAXED))) {
+			this->unpark_slow(kind, n);
+		}
+	}
+
+private:
+	void unpark_slow(unsigned kind, size_t n);
+
+};
+
+
+// A bounded multi-producer, multi-consumer queue after Dmitry Vyukov's: every cell carries a sequence
+// number that says whether it is ready to be written or read at a given lap, so both ends proceed with
+// one CAS per operation, or per batch. Blocking operations park on a futex only when full or empty.
+// The capacity is rounded up to a power of two.
+template <typename T, bool SingleProducerConsumer = false>
+class RingQueue : public _RingQueue {
+	static_assert(std::is_nothrow_move_constructible_v<T> && std::is_nothrow_move_assignable_v<T>);
+
+private:
+	struct Cell {
+		std::atomic<size_t> seq;
+		alignas(T) std::byte storage[sizeof(T)];
+	};
+
+private:
+	alignas(cache_line) std::atomic<size_t> enqueue_pos;
+	alignas(cache_line) std::atomic<size_t> dequeue_pos;
+	alignas(cache_line) const size_t mask;
+	const std::unique_ptr<Cell[]> cells;
+
+public:
+	explicit RingQueue(size_t capacity) : enqueue_pos(), dequeue_pos(), mask(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1), cells(new Cell[mask + 1]) {
+		for (size_t i = 0; i <= mask; ++i) {
+			cells[i].seq.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	~RingQueue() {
+		while (this->claim_pop(SIZE_MAX, [](T &&, size_t) noexcept { }));
+	}
+
+private:
+	RingQueue(const RingQueue &) = delete;
+	RingQueue & operator=(const RingQueue &) = delete;
+
+public:
+	size_t _pure capacity() const noexcept { return mask + 1; }
+
+	template <typename U>
+	_nodiscard bool try_push(U &&value) {
+		return this->claim_push(1, [&value](void *where, size_t) { ::new (where) T(std::forward<U>(value)); }) && (this->unpark(consumers, 1), true);
+	}
+
+	// moves as many values as will fit from the front of values; returns how many
+	_nodiscard size_t try_push(std::span<T> values) {
+		size_t n = this->claim_push(values.size(), [values](void *where, size_t i) { ::new (where) T(std::move(values[i])); });
+		if (n) {
+			this->unpark(consumers, n);
+		}
+		return n;
+	}
+
+	template <typename U>
+	void push(U &&value) {
+		while (!this->try_push(std::forward<U>(value))) {
+			this->park(producers, [this]() noexcept { return this->can_push(); });
+		}
+	}
+
+	void push(std::span<T> values) {
+		while (!values.empty()) {
+			if (size_t n = this->try_push(values)) {
+				values = values.subspan(n);
+			}
+			else {
+				this->park(producers, [this]() noexcept { return this->can_push(); });
+			}
+		}
+	}
+
+	_nodiscard bool try_pop(T &value) {
+		return this->claim_pop(1, [&value](T &&popped, size_t) { value = std::move(popped); }) && (this->unpark(producers, 1), true);
+	}
+
+	// moves as many values as are available into the front of values; returns how many
+	_nodiscard size_t try_pop(std::span<T> values) {
+		size_t n = this->claim_pop(values.size(), [values](T &&popped, size_t i) { values[i] = std::move(popped); });
+		if (n) {
+			this->unpark(producers, n);
+		}
+		return n;
+	}
+
+	T pop() {
+		std::optional<T> value;
+		while (!this->claim_pop(1, [&value](T &&popped, size_t) { value.emplace(std::move(popped)); })) {
+			this->park(consumers, [this]() noexcept { return this->can_pop(); });
+		}
+		this->unpark(producers, 1);
+		return std::move(*value);
+	}
+
+	// waits until at least one value is available, then pops like try_pop
+	size_t pop(std::span<T> values) {
+		size_t n;
+		while (!values.empty() && (n = this->try_pop(values)) == 0) {
+			this->park(consumers, [this]() noexcept { return this->can_pop(); });
+		}
+		return values.empty() ? 0 : n;
+	}
+
+private:
+	bool can_push() const noexcept {
+		size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+		return static_cast<ptrdiff_t>(cells[pos & mask].seq.load(std::memory_order_relaxed) - pos) >= 0;
+	}
+
+	bool can_pop() const noexcept {
+		size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+		return static_cast<ptrdiff_t>(cells[pos & mask].seq.load(std::memory_order_relaxed) - (pos + 1)) >= 0;
+	}
+
+	template <typename Construct>
+	size_t claim_push(size_t n, Construct &&construct) {
+		size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+		for (;;) {
+			size_t m = 0;
+			while (m < n && m <= mask && cells[pos + m & mask].seq.load(std::memory_order_acquire) == pos + m) {
+				++m;
+			}
+			if (m == 0) {
+				if (static_cast<ptrdiff_t>(cells[pos & mask].seq.load(std::memory_order_relaxed) - pos) < 0) {
+					return 0; // full
+				}
+				pos = enqueue_pos.load(std::memory_order_relaxed);
+			}
+			else if (enqueue_pos.compare_exchange_weak(pos, pos + m, std::memory_order_relaxed, std::memory_order_relaxed)) {
+				for (size_t i = 0; i < m; ++i) {
+					Cell &cell = cells[pos + i & mask];
+					construct(static_cast<void *>(cell.storage), i);
+					cell.seq.store(pos + i + 1, std::memory_order_release);
+				}
+				return m;
+			}
+		}
+	}
+
+	template <typename Consume>
+	size_t claim_pop(size_t n, Consume &&consume) {
+		size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+		for (;;) {
+			size_t m = 0;
+			while (m < n && m <= mask && cells[pos + m & mask].seq.load(std::memory_order_acquire) == pos + m + 1) {
+				++m;
+			}
+			if (m == 0) {
+				if (static_cast<ptrdiff_t>(cells[pos & mask].seq.load(std::memory_order_relaxed) - (pos + 1)) < 0) {
+					return 0; // empty
+				}
+				pos = dequeue_pos.load(std::memory_order_relaxed);
+			}
+			else if (dequeue_pos.compare_exchange_weak(pos, pos + m, std::memory_order_relaxed, std::memory_order_relaxed)) {
+				for (size_t i = 0; i < m; ++i) {
+					Cell &cell = cells[pos + i & mask];
+					T &value = *std::launder(reinterpret_cast<T *>(cell.storage));
+					consume(std::move(value), i);
+					value.~T();
+					cell.seq.store(pos + i + mask + 1, std::memory_order_release);
+				}
+				return m;
+			}
+		}
+	}
+
+};
+
+
+// The single-producer, single-consumer specialization: each end owns its index and keeps a cached copy
+// of the other end's, so the fast paths touch no shared cache line unless the cached copy runs out.
+template <typename T>
+class RingQueue<T, true> : public _RingQueue {
+	static_assert(std::is_nothrow_move_constructible_v<T> && std::is_nothrow_move_assignable_v<T>);
+
+private:
+	struct Slot {
+		alignas(T) std::byte storage[sizeof(T)];
+	};
+
+private:
+	alignas(cache_line) std::atomic<size_t> tail;
+	size_t cached_head;
+	alignas(cache_line) std::atomic<size_t> head;
+	size_t cached_tail;
+	alignas(cache_line) const size_t mask;
+	const std::unique_ptr<Slot[]> slots;
+
+public:
+	explicit RingQueue(size_t capacity) : tail(), cached_head(), head(), cached_tail(), mask(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1), slots(new Slot[mask + 1]) { }
+
+	~RingQueue() {
+		for (size_t h = head.load(std::memory_order_relaxed), t = tail.load(std::memory_order_relaxed); h != t; ++h) {
+			this->at(h).~T();
+		}
+	}
+
+private:
+	RingQueue(const RingQueue &) = delete;
+	RingQueue & operator=(const RingQueue &) = delete;
+
+public:
+	size_t _pure capacity() const noexcept { return mask + 1; }
+
+	template <typename U>
+	_nodiscard bool try_push(U &&value) {
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (this->space(t) == 0) {
+			return false;
+		}
+		::new (static_cast<void *>(slots[t & mask].storage)) T(std::forward<U>(value));
+		tail.store(t + 1, std::memory_order_release);
+		this->unpark(consumers, 1);
+		return true;
+	}
+
+	_nodiscard size_t try_push(std::span<T> values) {
+		size_t t = tail.load(std::memory_order_relaxed), n = std::min(values.size(), this->space(t));
+		for (size_t i = 0; i < n; ++i) {
+			::new (static_cast<void *>(slots[t + i & mask].storage)) T(std::move(values[i]));
+		}
+		if (n) {
+			tail.store(t + n, std::memory_order_release);
+			this->unpark(consumers, 1);
+		}
+		return n;
+	}
+
+	template <typename U>
+	void push(U &&value) {
+		while (!this->try_push(std::forward<U>(value))) {
+			this->park(producers, [this]() noexcept { return tail.load(std::memory_order_relaxed) - head.load(std::memory_order_relaxed) <= mask; });
+		}
+	}
+
+	void push(std::span<T> values) {
+		while (!values.empty()) {
+			if (size_t n = this->try_push(values)) {
+				values = values.subspan(n);
+			}
+			else {
+				this->park(producers, [this]() noexcept { return tail.load(std::memory_order_relaxed) - head.load(std::memory_order_relaxed) <= mask; });
+			}
+		}
+	}
+
+	_nodiscard bool try_pop(T &value) {
+		return this->try_pop(std::span<T>(&value, 1)) != 0;
+	}
+
+	_nodiscard size_t try_pop(std::span<T> values) {
+		size_t h = head.load(std::memory_order_relaxed), n = std::min(values.size(), this->available(h));
+		for (size_t i = 0; i < n; ++i) {
+			T &value = this->at(h + i);
+			values[i] = std::move(value);
+			value.~T();
+		}
+		if (n) {
+			head.store(h + n, std::memory_order_release);
+			this->unpark(producers, 1);
+		}
+		return n;
+	}
+
+	T pop() {
+		size_t h = head.load(std::memory_order_relaxed);
+		while (this->available(h) == 0) {
+			this->park(consumers, [this, h]() noexcept { return tail.load(std::memory_order_relaxed) != h; });
+		}
+		T &slot = this->at(h), value(std::move(slot));
+		slot.~T();
+		head.store(h + 1, std::memory_order_release);
+		this->unpark(producers, 1);
+		return value;
+	}
+
+	size_t pop(std::span<T> values) {
+		size_t n;
+		while (!values.empty() && (n = this->try_pop(values)) == 0) {
+			this->park(consumers, [this]() noexcept { return tail.load(std::memory_order_relaxed) != head.load(std::memory_order_relaxed); });
+		}
+		return values.empty() ? 0 : n;
+	}
+
+private:
+	T & at(size_t index) noexcept { return *std::launder(reinterpret_cast<T *>(slots[index & mask].storage)); }
+
+	size_t space(size_t t) noexcept {
+		if (t - cached_head > mask) {
+			cached_head = head.load(std::memory_order_acquire);
+		}
+		return mask + 1 - (t - cached_head);
+	}
+
+	size_t available(size_t h) noexcept {
+		if (cached_tail == h) {
+			cached_tail = tail.load(std::memory_order_acquire);
+		}
+		return cached_tail - h;
+	}
+
+};
@@ -1,24 +1,108 @@
 #include "scheduler.h"
 
+#include <stdexcept>
+
 
 template <typename Clock>
-void Scheduler<Clock>::run() {
-	std::unique_lock<std::mutex> lock(mutex);
-	for (;;) {
-		if (queue.empty()) {
-			condition.wait(lock);
+static inline TimingWheel::tick_t _pure floor_tick(typename Clock::time_point time) noexcept {
+	auto tick = std::chrono::floor<std::chrono::milliseconds>(time.time_since_epoch()).count();
+	return tick < 0 ? 0 : static_cast<TimingWheel::tick_t>(tick);
+}
+
+
+template <typename Clock>
+bool Scheduler<Clock>::Handle::cancel() noexcept {
+	auto state = Work::State::PENDING;
+	if (!work || !work->state.compare_exchange_strong(state, Work::State::CANCELLED, std::memory_order_acq_rel)) {
+		return false;
+	}
+	// the cancelled list holds its own reference, as the run thread may expire the work meanwhile
+	work->refs.fetch_add(1, std::memory_order_relaxed);
+	auto &cancelled = work->scheduler->cancelled;
+	work->next_cancelled = cancelled.load(std::memory_order_relaxed);
+	while (!cancelled.compare_exchange_weak(work->next_cancelled, work, std::memory_order_release, std::memory_order_relaxed));
+	return true;
+}
+
+template <typename Clock>
+Scheduler<Clock>::Scheduler(Executor *executor) : posted(), cancelled(), wake_tick(TimingWheel::never), wheel(floor_tick<Clock>(clock_t::now())), executor(executor), runner() {
+}
+
+template <typename Clock>
+Scheduler<Clock>::~Scheduler() {
+	this->drain();
+	wheel.advance(wheel.now() + TimingWheel::max_delta, [](TimingWheel::Entry &entry) {
+		auto &work = static_cast<Work &>(entry);
+		// a Handle that outlives us must not reach back into our cancelled list
+		work.state.store(Work::State::CANCELLED, std::memory_order_release);
+		work.release();
+	});
+}
+
+template <typename Clock>
+auto Scheduler<Clock>::post(Work *work) -> Handle {
+	work->next_posted = posted.load(std::memory_order_relaxed);
+	while (!posted.compare_exchange_weak(work->next_posted, work, std::memory_order_seq_cst, std::memory_order_relaxed));
+	if (work->tick < wake_tick.load(std::memory_order_seq_cst)) {
+		std::lock_guard<mutex_t> lock(mutex);
+		condition.notify_one();
+	}
+	return Handle(work);
+}
+
+template <typename Clock>
+void Scheduler<Clock>::drain() noexcept {
+	// arm posted work before processing cancellations, so that cancelled work is never armed afterward
+	for (Work *work = posted.exchange(nullptr, std::memory_order_acquire), *next; work; work = next) {
+		next = work->next_posted;
+		if (work->state.load(std::memory_order_acquire) == Work::State::CANCELLED) {
+			work->release();
 		}
 		else {
-			auto &work = queue.top();
-			if (clock_t::now() < work.deadline) {
-				condition.wait_until(lock, work.deadline);
+			wheel.arm(*work, work->tick);
+		}
+	}
+	for (Work *work = cancelled.exchange(nullptr, std::memory_order_acquire), *next; work; work = next) {
+		next = work->next_cancelled;
+		if (work->armed()) {
+			work->cancel();
+			work->release();
+		}
+		work->release();
+	}
+}
+
+template <typename Clock>
+void Scheduler<Clock>::run() {
+	// the wheel and the posted and cancelled lists are consumed without locks, so there can be only one runner
+	if (std::thread::id none; _unlikely(!runner.compare_exchange_strong(none, std::this_thread::get_id(), std::memory_order_relaxed))) {
+		throw std::logic_error("Scheduler::run called twice");
+	}
+	for (;;) {
+		this->drain();
+		wheel.advance(floor_tick<Clock>(clock_t::now()), [executor = executor](TimingWheel::Entry &entry) {
+			auto &work = static_cast<Work &>(entry);
+			auto state = Work::State::PENDING;
+			if (work.state.compare_exchange_strong(state, Work::State::RUNNING, std::memory_order_acq_rel)) {
+				if (executor) {
+					executor->execute(std::move(work.task));
+				}
+				else {
+					work.task();
+				}
+				work.task = nullptr;
+			}
+			work.release();
+		});
+		TimingWheel::tick_t next = wheel.next_tick();
+		wake_tick.store(next, std::memory_order_seq_cst);
+		std::unique_lock<mutex_t> lock(mutex);
+		if (!posted.load(std::memory_order_seq_cst)) {
+			if (next == TimingWheel::never) {
+				condition.wait(lock);
 			}
 			else {
-				auto task = std::move(work.task);
-				queue.pop();
-				lock.unlock();
-				task();
-				lock.lock();
+				condition.wait_until(lock, time_point_t(std::chrono::duration_cast<duration_t>(std::chrono::milliseconds(next))));
 			}
 		}
 	}
@@ -1,12 +1,18 @@
-#include <condition_variable>
-#include <functional>
-#include <memory>
-#include <mutex>
-#include <queue>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <utility>
 
 #include "compiler.h"
+#include "executor.h"
+#include "sync.h"
+#include "timingwheel.h"
 
 
+// Runs tasks at or soon after their deadlines, to millisecond resolution. Any thread may schedule or
+// cancel tasks without blocking; run() may be called only once, on the one thread that keeps time.
+// Given an Executor, run() only keeps time and hands each due task to the executor's least-loaded
+// worker.
 template <typename Clock>
 class Scheduler {
 
@@ -14,36 +20,80 @@ public:
 	typedef Clock clock_t;
 	typedef typename clock_t::time_point time_point_t;
 	typedef typename clock_t::duration duration_t;
+	typedef Executor::task_t task_t;
 
 private:
-	struct Work {
-		time_point_t deadline;
-		std::function<void (void) /* noexcept */> task;
-		bool _pure operator>(const Work &other) const noexcept { return deadline > other.deadline; }
+	struct Work : TimingWheel::Entry {
+		enum class State : unsigned char { PENDING, RUNNING, CANCELLED };
+		Scheduler * const scheduler;
+		const TimingWheel::tick_t tick;
+		Work *next_posted, *next_cancelled;
+		std::atomic<unsigned> refs;
+		std::atomic<State> state;
+		task_t task;
+		template <typename T>
+		Work(Scheduler *scheduler, TimingWheel::tick_t tick, T &&task) : scheduler(scheduler), tick(tick), next_posted(), next_cancelled(), refs(2), state(State::PENDING), task(std::forward<T>(task)) { }
+		void release() noexcept { if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this; }
 	};
 
+public:
+	// Refers to a scheduled task. Dropping a Handle does not cancel its task. A Handle may outlive its
+	// Scheduler, which cancels on destruction whatever it has not run, so cancel() then returns false.
+	class Handle {
+		friend Scheduler;
+	private:
+		Work *work;
+	private:
+		explicit Handle(Work *work) noexcept : work(work) { }
+	public:
+		Handle() noexcept : work() { }
+		Handle(Handle &&move) noexcept : work(std::exchange(move.work, nullptr)) { }
+		Handle & operator=(Handle &&move) noexcept { Handle(std::move(move)).swap(*this); return *this; }
+		~Handle() { if (work) work->release(); }
+		void swap(Handle &other) noexcept { std::swap(work, other.work); }
+		explicit _pure operator bool () const noexcept { return work; }
+		// prevents the task from running and frees it soon after; returns false if it has already started
+		bool cancel() noexcept;
+	};
+
+private:
+	std::atomic<Work *> posted, cancelled;
+	std::atomic<TimingWheel::tick_t> wake_tick;
+	mutex_t mutex;
+	condition_variable_t condition;
+	TimingWheel wheel;
+	Executor * const executor;
+	std::atomic<std::thread::id> runner;
+
+public:
+	explicit Scheduler(Executor *executor = nullptr);
+	~Scheduler();
+
 private:
-	std::mutex mutex;
-	std::condition_variable condition;
-	std::priority_queue<Work, std::vector<Work>, std::greater<Work>> queue;
+	Scheduler(const Scheduler &) = delete;
+	Scheduler & operator=(const Scheduler &) = delete;
 
 public:
+	Executor * get_executor() const noexcept { return executor; }
+
+	// throws std::logic_error if run() has already been called
 	_noreturn void run();
 
 	template <typename T>
-	void call_at(time_point_t deadline, T &&task) {
-		std::lock_guard<std::mutex> lock(mutex);
-		if (queue.empty() || deadline < queue.top().deadline) {
-			condition.notify_one();
-		}
-		queue.push({ deadline, std::forward<T>(task) });
+	Handle call_at(time_point_t deadline, T &&task) {
+		auto tick = std::chrono::ceil<std::chrono::milliseconds>(deadline.time_since_epoch()).count();
+		return this->post(new Work(this, tick < 0 ? 0 : static_cast<TimingWheel::tick_t>(tick), std::forward<T>(task)));
 	}
 
 	template <typename T>
-	void call_after(duration_t delay, T &&task) {
-		this->call_at(Clock::now() + delay, std::forward<T>(task));
+	Handle call_after(duration_t delay, T &&task) {
+		return this->call_at(Clock::now() + delay, std::forward<T>(task));
 	}
 
+private:
+	Handle post(Work *work);
+	void drain() noexcept;
+
 };
 
 extern template class Scheduler<std::chrono::system_clock>;
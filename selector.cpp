@@ -1,108 +1,425 @@
 #include "selector.h"
 
+#include "reactorstats.h"
+
 
 #ifdef __linux__
 
+#include <algorithm>
 #include <climits>
 
 #include <sys/epoll.h>
 #include <sys/eventfd.h>
+#include <sys/socket.h>
 
 #undef linux
 namespace linux {
 
-static void epoll_ctl(FileDescriptor &epoll_fd, int op, FileDescriptor &fd, void *ptr, Selector::Flags flags) {
-	struct epoll_event event;
-	event.events = EPOLLONESHOT |
-			((flags & Selector::Flags::READABLE) != Selector::Flags::NONE ? static_cast<uint32_t>(EPOLLIN) : 0) |
-			((flags & Selector::Flags::WRITABLE) != Selector::Flags::NONE ? static_cast<uint32_t>(EPOLLOUT) : 0);
-	event.data.ptr = ptr;
-	if (_unlikely(::epoll_ctl(epoll_fd, op, fd, &event) < 0)) {
-		throw std::system_error(errno, std::system_category(), "epoll_ctl");
+static constexpr Selector::Flags _const epoll_events_to_flags(uint32_t events) noexcept {
+	return (events & EPOLLIN ? Selector::Flags::READABLE : Selector::Flags::NONE) |
+			(events & EPOLLOUT ? Selector::Flags::WRITABLE : Selector::Flags::NONE);
+}
+
+static inline int timeout_to_int(std::chrono::milliseconds timeout) noexcept {
+	return static_cast<int>(std::min(std::max(timeout, std::chrono::milliseconds::zero()), std::chrono::milliseconds(INT_MAX)).count());
+}
+
+static inline void set_busy_poll(FileDescriptor &fd, int usecs) noexcept {
+	// not every descriptor is a socket, and raising SO_BUSY_POLL may need CAP_NET_ADMIN
+	_unused int r = ::setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &usecs, sizeof usecs);
+}
+
+// for counters with a single writer, which need no read-modify-write to stay exact
+static inline void increment(std::atomic<uint64_t> &counter) noexcept {
+	counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+static inline TimingWheel::tick_t steady_tick(std::chrono::steady_clock::time_point time_point = std::chrono::steady_clock::now()) noexcept {
+	return std::chrono::floor<std::chrono::milliseconds>(time_point.time_since_epoch()).count();
+}
+
+} // namespace linux
+
+
+#ifdef SELECTOR_IO_URING
+
+namespace linux {
+
+static constexpr uint64_t ignored_user_data = UINT64_MAX;
+
+static constexpr uint64_t _const make_user_data(int fd, uint32_t gen) noexcept {
+	return static_cast<uint64_t>(gen) << 32 | static_cast<uint32_t>(fd);
+}
+
+static constexpr uint32_t _const flags_to_poll_events(Selector::Flags flags) noexcept {
+	return ((flags & Selector::Flags::READABLE) != Selector::Flags::NONE ? static_cast<uint32_t>(POLLIN) : 0) |
+			((flags & Selector::Flags::WRITABLE) != Selector::Flags::NONE ? static_cast<uint32_t>(POLLOUT) : 0);
+}
+
+} // namespace linux
+
+Selector::Selector() : posted(), timers(linux::steady_tick()), spin_budget(), spin_current(), socket_busy_poll(), spin_hits(), spin_misses(), blocking_waits(), selecting_thread(), ring(256), event_fd(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+	if (_unlikely(!event_fd)) {
+		throw std::system_error(errno, std::system_category(), "eventfd");
 	}
+	if (_unlikely(!(ring.get_features() & IORING_FEAT_EXT_ARG))) {
+		throw std::system_error(ENOSYS, std::system_category(), "io_uring_enter");
+	}
+	this->add(event_fd, static_cast<void *>(nullptr), Flags::READABLE | Flags::EDGE_TRIGGERED);
 }
 
-static std::pair<void *, Selector::Flags> epoll_wait(FileDescriptor &epoll_fd, int timeout) {
-	struct epoll_event event;
-	int n = ::epoll_wait(epoll_fd, &event, 1, timeout);
-	if (_unlikely(n < 0 && errno != EINTR)) {
-		throw std::system_error(errno, std::system_category(), "epoll_wait");
+// until some thread selects, whoever registers may submit
+bool Selector::may_submit() const noexcept {
+	return selecting_thread == std::thread::id() || selecting_thread == std::this_thread::get_id();
+}
+
+void Selector::make_room(std::unique_lock<mutex_t> &lock, unsigned n) {
+	while (ring.capacity() - ring.pending() < n) {
+		if (this->may_submit()) {
+			ring.submit();
+		}
+		else {
+			lock.unlock();
+			this->kick();
+			std::this_thread::yield();
+			lock.lock();
+		}
+	}
+}
+
+void Selector::queued(std::unique_lock<mutex_t> &lock) {
+	if (!this->may_submit()) {
+		lock.unlock();
+		this->kick();
 	}
-	if (n <= 0) {
-		return { nullptr, Selector::Flags::NONE };
+}
+
+struct io_uring_sqe * Selector::get_sqe() {
+	struct io_uring_sqe *sqe;
+	while (!(sqe = ring.get_sqe())) {
+		ring.submit();
 	}
-	return { +event.data.ptr,
-			(event.events & EPOLLIN ? Selector::Flags::READABLE : Selector::Flags::NONE) |
-			(event.events & EPOLLOUT ? Selector::Flags::WRITABLE : Selector::Flags::NONE) };
+	return sqe;
 }
 
-static std::pair<void *, Selector::Flags> epoll_pwait(FileDescriptor &epoll_fd, int timeout, const sigset_t *sigmask) {
-	struct epoll_event event;
-	int n = ::epoll_pwait(epoll_fd, &event, 1, timeout, sigmask);
-	if (_unlikely(n < 0 && errno != EINTR)) {
-		throw std::system_error(errno, std::system_category(), "epoll_pwait");
+void Selector::poll_arm(int fd, Registration &reg) {
+	struct io_uring_sqe *sqe = this->get_sqe();
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = fd;
+	sqe->poll32_events = linux::flags_to_poll_events(reg.flags);
+	if ((reg.flags & Flags::EDGE_TRIGGERED) != Flags::NONE) {
+		sqe->len = IORING_POLL_ADD_MULTI;
+	}
+	sqe->user_data = linux::make_user_data(fd, reg.gen);
+	reg.armed = true;
+}
+
+void Selector::poll_disarm(int fd, Registration &reg) {
+	if (reg.armed) {
+		struct io_uring_sqe *sqe = this->get_sqe();
+		sqe->opcode = IORING_OP_POLL_REMOVE;
+		sqe->fd = -1;
+		sqe->addr = linux::make_user_data(fd, reg.gen);
+		sqe->user_data = linux::ignored_user_data;
+		reg.armed = false;
+	}
+	++reg.gen;
+}
+
+void Selector::add(FileDescriptor &fd, void *ptr, Flags flags) {
+	if (int busy_poll = socket_busy_poll.load(std::memory_order_relaxed)) {
+		linux::set_busy_poll(fd, busy_poll);
+	}
+	std::unique_lock<mutex_t> lock(ring_mutex);
+	this->make_room(lock, 2);
+	if (static_cast<size_t>(fd) >= registrations.size()) {
+		registrations.resize(static_cast<size_t>(fd) + 1);
+	}
+	auto &reg = registrations[fd];
+	this->poll_disarm(fd, reg);
+	reg.ptr = ptr, reg.flags = flags;
+	this->poll_arm(fd, reg);
+	this->queued(lock);
+}
+
+void Selector::modify(FileDescriptor &fd, void *ptr, Flags flags) {
+	std::unique_lock<mutex_t> lock(ring_mutex);
+	if (_unlikely(static_cast<size_t>(fd) >= registrations.size())) {
+		throw std::system_error(ENOENT, std::system_category(), "io_uring poll update");
+	}
+	this->make_room(lock, 2);
+	auto &reg = registrations[fd];
+	this->poll_disarm(fd, reg);
+	reg.ptr = ptr, reg.flags = flags;
+	this->poll_arm(fd, reg);
+	this->queued(lock);
+}
+
+void Selector::add_or_modify(FileDescriptor &fd, void *ptr, Flags flags) {
+	this->add(fd, ptr, flags);
+}
+
+void Selector::remove(FileDescriptor &fd) {
+	std::unique_lock<mutex_t> lock(ring_mutex);
+	if (static_cast<size_t>(fd) < registrations.size()) {
+		this->make_room(lock, 1);
+		auto &reg = registrations[fd];
+		this->poll_disarm(fd, reg);
+		reg.ptr = nullptr, reg.flags = Flags::NONE;
+		this->queued(lock);
+	}
+}
+
+std::span<Selector::Event> Selector::wait(std::span<Event> events, int timeout, const sigset_t *sigmask) {
+	std::unique_lock<mutex_t> lock(ring_mutex);
+	selecting_thread = std::this_thread::get_id();
+	for (int fd : rearm_fds) {
+		auto &reg = registrations[fd];
+		if (!reg.armed && (reg.flags & Flags::PERSISTENT) != Flags::NONE) {
+			this->poll_arm(fd, reg);
+		}
 	}
-	if (n <= 0) {
-		return { nullptr, Selector::Flags::NONE };
+	rearm_fds.clear();
+	ring.submit();
+	if (!ring.peek() && timeout != 0) {
+		// other threads may queue entries while we sleep; they kick us to submit them
+		struct timespec ts = posix::duration_to_timespec(std::chrono::milliseconds(timeout));
+		lock.unlock();
+		ring.wait(1, timeout < 0 ? nullptr : &ts, sigmask);
+		lock.lock();
+	}
+	size_t n = 0;
+	for (const struct io_uring_cqe *cqe; n < events.size() && (cqe = ring.peek()); ring.advance()) {
+		if (cqe->user_data == linux::ignored_user_data) {
+			continue;
+		}
+		int fd = static_cast<int>(cqe->user_data & UINT32_MAX);
+		auto &reg = registrations[fd];
+		if (reg.gen != static_cast<uint32_t>(cqe->user_data >> 32)) {
+			continue;
+		}
+		if (!(cqe->flags & IORING_CQE_F_MORE)) {
+			reg.armed = false;
+		}
+		if (cqe->res == -ECANCELED) {
+			continue;
+		}
+		Flags flags = cqe->res < 0 ? reg.flags & (Flags::READABLE | Flags::WRITABLE) : linux::epoll_events_to_flags(static_cast<uint32_t>(cqe->res));
+		if (!reg.armed && (reg.flags & Flags::EDGE_TRIGGERED) != Flags::NONE) {
+			this->poll_arm(fd, reg);
+		}
+		else if (!reg.armed && (reg.flags & Flags::PERSISTENT) != Flags::NONE) {
+			rearm_fds.push_back(fd);
+		}
+		events[n++] = { reg.ptr, flags };
+	}
+	return events.first(n);
+}
+
+#else // !defined(SELECTOR_IO_URING)
+
+namespace linux {
+
+static bool epoll_ctl(FileDescriptor &epoll_fd, int op, FileDescriptor &fd, void *ptr, Selector::Flags flags, int tolerate = 0) {
+	struct epoll_event event;
+	event.events =
+			((flags & Selector::Flags::EDGE_TRIGGERED) != Selector::Flags::NONE ? static_cast<uint32_t>(EPOLLET) :
+			 (flags & Selector::Flags::PERSISTENT) != Selector::Flags::NONE ? 0 : static_cast<uint32_t>(EPOLLONESHOT)) |
+			((flags & Selector::Flags::READABLE) != Selector::Flags::NONE ? static_cast<uint32_t>(EPOLLIN) : 0) |
+			((flags & Selector::Flags::WRITABLE) != Selector::Flags::NONE ? static_cast<uint32_t>(EPOLLOUT) : 0);
+	event.data.ptr = ptr;
+	if (_unlikely(::epoll_ctl(epoll_fd, op, fd, &event) < 0)) {
+		if (errno != tolerate) {
+			throw std::system_error(errno, std::system_category(), "epoll_ctl");
+		}
+		return false;
 	}
-	return { +event.data.ptr,
-			(event.events & EPOLLIN ? Selector::Flags::READABLE : Selector::Flags::NONE) |
-			(event.events & EPOLLOUT ? Selector::Flags::WRITABLE : Selector::Flags::NONE) };
+	return true;
 }
 
 } // namespace linux
 
-Selector::Selector() : epoll_fd(::epoll_create1(EPOLL_CLOEXEC)) {
+Selector::Selector() : posted(), timers(linux::steady_tick()), spin_budget(), spin_current(), socket_busy_poll(), spin_hits(), spin_misses(), blocking_waits(), epoll_fd(::epoll_create1(EPOLL_CLOEXEC)), event_fd(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
 	if (_unlikely(!epoll_fd)) {
 		throw std::system_error(errno, std::system_category(), "epoll_create1");
 	}
+	if (_unlikely(!event_fd)) {
+		throw std::system_error(errno, std::system_category(), "eventfd");
+	}
+	this->add(event_fd, static_cast<void *>(nullptr), Flags::READABLE | Flags::EDGE_TRIGGERED);
 }
 
 void Selector::add(FileDescriptor &fd, void *ptr, Flags flags) {
-	return linux::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, ptr, flags);
+	if (int busy_poll = socket_busy_poll.load(std::memory_order_relaxed)) {
+		linux::set_busy_poll(fd, busy_poll);
+	}
+	linux::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, ptr, flags);
 }
 
 void Selector::modify(FileDescriptor &fd, void *ptr, Flags flags) {
-	return linux::epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, ptr, flags);
+	linux::epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, ptr, flags);
+}
+
+void Selector::add_or_modify(FileDescriptor &fd, void *ptr, Flags flags) {
+	if (!linux::epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, ptr, flags, ENOENT)) {
+		linux::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, ptr, flags);
+	}
 }
 
 void Selector::remove(FileDescriptor &fd) {
-	return linux::epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr, Flags::NONE);
+	linux::epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr, Flags::NONE);
+}
+
+std::span<Selector::Event> Selector::wait(std::span<Event> events, int timeout, const sigset_t *sigmask) {
+	if (_unlikely(events.empty())) {
+		return events;
+	}
+	// any events beyond this many are left for the next call
+	struct epoll_event epoll_events[256];
+	int n = ::epoll_pwait(epoll_fd, epoll_events, static_cast<int>(std::min(events.size(), std::size(epoll_events))), timeout, sigmask);
+	if (_unlikely(n < 0 && errno != EINTR)) {
+		throw std::system_error(errno, std::system_category(), sigmask ? "epoll_pwait" : "epoll_wait");
+	}
+	for (int i = 0; i < n; ++i) {
+		events[i] = { +epoll_events[i].data.ptr, linux::epoll_events_to_flags(epoll_events[i].events) };
+	}
+	return events.first(std::max(n, 0));
 }
 
-std::pair<void *, Selector::Flags> Selector::select() {
-	return linux::epoll_wait(epoll_fd, -1);
+#endif // defined(SELECTOR_IO_URING)
+
+Selector::~Selector() {
+	for (Posted *p = posted.load(std::memory_order_acquire), *next; p; p = next) {
+		next = p->next;
+		delete p;
+	}
+}
+
+void Selector::kick() {
+	if (_unlikely(::eventfd_write(event_fd, 1) < 0 && errno != EAGAIN)) {
+		throw std::system_error(errno, std::system_category(), "eventfd_write");
+	}
 }
 
-std::pair<void *, Selector::Flags> Selector::select(std::chrono::milliseconds timeout) {
-	return linux::epoll_wait(epoll_fd, static_cast<int>(std::min(std::max(timeout, std::chrono::milliseconds::zero()), std::chrono::milliseconds(INT_MAX)).count()));
+void Selector::post(Posted *p) {
+	Posted *head = posted.load(std::memory_order_relaxed);
+	do {
+		p->next = head;
+	} while (!posted.compare_exchange_weak(head, p, std::memory_order_release, std::memory_order_relaxed));
+	if (!head) {
+		this->kick();
+	}
 }
 
-std::pair<void *, Selector::Flags> Selector::pselect(const sigset_t *sigmask) {
-	return linux::epoll_pwait(epoll_fd, -1, sigmask);
+void Selector::arm(Timer &timer, std::chrono::steady_clock::time_point deadline) noexcept {
+	timers.arm(timer, std::chrono::ceil<std::chrono::milliseconds>(deadline.time_since_epoch()).count());
 }
 
-std::pair<void *, Selector::Flags> Selector::pselect(std::chrono::milliseconds timeout, const sigset_t *sigmask) {
-	return linux::epoll_pwait(epoll_fd, static_cast<int>(std::min(std::max(timeout, std::chrono::milliseconds::zero()), std::chrono::milliseconds(INT_MAX)).count()), sigmask);
+bool Selector::run_timers() {
+	return timers.advance(linux::steady_tick(), [this](TimingWheel::Entry &entry) {
+		static_cast<Timer &>(entry).expired(*this);
+	}) > 0;
 }
 
-void Selector::kick() {
-	struct epoll_event event;
-	event.events = EPOLLIN | EPOLLONESHOT;
-	event.data.ptr = nullptr;
-	int op;
-	if (!event_fd) {
-		if (_unlikely(!(event_fd = FileDescriptor(::eventfd(1, EFD_CLOEXEC))))) {
-			throw std::system_error(errno, std::system_category(), "eventfd");
+int Selector::bound_timeout(int timeout) const noexcept {
+	TimingWheel::tick_t next = timers.next_tick();
+	if (next == TimingWheel::never) {
+		return timeout;
+	}
+	TimingWheel::tick_t now = linux::steady_tick();
+	int until = next <= now ? 0 : saturate<int>(next - now);
+	return timeout < 0 ? until : std::min(timeout, until);
+}
+
+void Selector::busy_poll(std::chrono::nanoseconds budget, std::chrono::microseconds socket_busy_poll) noexcept {
+	spin_current = spin_budget = std::max(budget, std::chrono::nanoseconds::zero());
+	this->socket_busy_poll.store(static_cast<int>(std::clamp<std::chrono::microseconds::rep>(socket_busy_poll.count(), 0, INT_MAX)), std::memory_order_relaxed);
+}
+
+auto Selector::busy_poll_stats() const noexcept -> BusyPollStats {
+	return { spin_hits.load(std::memory_order_relaxed), spin_misses.load(std::memory_order_relaxed), blocking_waits.load(std::memory_order_relaxed) };
+}
+
+std::span<Selector::Event> Selector::poll(std::span<Event> events, int timeout, const sigset_t *sigmask) {
+	if ((timeout = this->bound_timeout(timeout)) != 0 && spin_current > std::chrono::nanoseconds::zero()) {
+		auto start = std::chrono::steady_clock::now(), deadline = start + (timeout < 0 ? spin_current : std::min<std::chrono::nanoseconds>(spin_current, std::chrono::milliseconds(timeout)));
+		do {
+			if (auto ready = this->wait(events, 0, sigmask); !ready.empty()) {
+				linux::increment(spin_hits);
+				spin_current = spin_budget;
+				return ready;
+			}
+			_cpu_relax();
+		} while (std::chrono::steady_clock::now() < deadline);
+		linux::increment(spin_misses);
+		spin_current /= 2;
+		if (timeout > 0) {
+			// the spin counts against the timeout
+			timeout -= std::min(timeout, saturate<int>(std::chrono::ceil<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count()));
 		}
-		op = EPOLL_CTL_ADD;
 	}
-	else {
-		op = EPOLL_CTL_MOD;
+	if (timeout != 0) {
+		linux::increment(blocking_waits);
+	}
+	auto ready = this->wait(events, timeout, sigmask);
+	if (!ready.empty() && spin_current < spin_budget) {
+		spin_current = std::min(std::max(spin_current * 2, spin_budget / 16), spin_budget);
+	}
+	return ready;
+}
+
+bool Selector::run_posted() noexcept {
+	Posted *p = posted.exchange(nullptr, std::memory_order_acquire);
+	if (!p) {
+		return false;
 	}
-	if (_unlikely(::epoll_ctl(epoll_fd, op, event_fd, &event) < 0)) {
-		throw std::system_error(errno, std::system_category(), "epoll_ctl");
+	Posted *reversed = nullptr;
+	do {
+		Posted *next = p->next;
+		p->next = reversed, reversed = p;
+		p = next;
+	} while (p);
+	for (std::unique_ptr<Posted> q; reversed; ) {
+		q.reset(reversed), reversed = q->next;
+		q->task();
 	}
+	return true;
+}
+
+Selector::Event Selector::select() {
+	Event event;
+	return this->poll({ &event, 1 }, -1, nullptr).empty() ? Event { nullptr, Flags::NONE } : event;
+}
+
+Selector::Event Selector::select(std::chrono::milliseconds timeout) {
+	Event event;
+	return this->poll({ &event, 1 }, linux::timeout_to_int(timeout), nullptr).empty() ? Event { nullptr, Flags::NONE } : event;
+}
+
+Selector::Event Selector::pselect(const sigset_t *sigmask) {
+	Event event;
+	return this->poll({ &event, 1 }, -1, sigmask).empty() ? Event { nullptr, Flags::NONE } : event;
+}
+
+Selector::Event Selector::pselect(std::chrono::milliseconds timeout, const sigset_t *sigmask) {
+	Event event;
+	return this->poll({ &event, 1 }, linux::timeout_to_int(timeout), sigmask).empty() ? Event { nullptr, Flags::NONE } : event;
+}
+
+std::span<Selector::Event> Selector::select(std::span<Event> events) {
+	return this->poll(events, -1, nullptr);
+}
+
+std::span<Selector::Event> Selector::select(std::span<Event> events, std::chrono::milliseconds timeout) {
+	return this->poll(events, linux::timeout_to_int(timeout), nullptr);
+}
+
+std::span<Selector::Event> Selector::pselect(std::span<Event> events, const sigset_t *sigmask) {
+	return this->poll(events, -1, sigmask);
+}
+
+std::span<Selector::Event> Selector::pselect(std::span<Event> events, std::chrono::milliseconds timeout, const sigset_t *sigmask) {
+	return this->poll(events, linux::timeout_to_int(timeout), sigmask);
 }
 
 #endif // defined(__linux__)
@@ -110,9 +427,73 @@ void Selector::kick() {
 
 void Selectable::pump(Selector &selector) {
 	for (;;) {
+		selector.run_posted();
+		selector.run_timers();
 		auto pair = selector.select();
 		if (pair.first) {
 			static_cast<Selectable *>(pair.first)->selected(selector, pair.second);
 		}
 	}
 }
+
+void Selectable::pump(Selector &selector, std::span<Selector::Event> events) {
+	for (;;) {
+		selector.run_posted();
+		selector.run_timers();
+		for (auto &event : selector.select(events)) {
+			if (event.first) {
+				static_cast<Selectable *>(event.first)->selected(selector, event.second);
+			}
+		}
+	}
+}
+
+void Selectable::pump(Selector &selector, std::span<Selector::Event> events, const std::atomic<bool> &stop) {
+	while (!stop.load(std::memory_order_acquire)) {
+		selector.run_posted();
+		selector.run_timers();
+		for (auto &event : selector.select(events)) {
+			if (event.first) {
+				static_cast<Selectable *>(event.first)->selected(selector, event.second);
+			}
+		}
+	}
+}
+
+void Selectable::pump(Selector &selector, ReactorStats &stats) {
+	for (;;) {
+		selector.run_posted();
+		selector.run_timers();
+		auto start = std::chrono::steady_clock::now();
+		auto pair = selector.select();
+		auto end = std::chrono::steady_clock::now();
+		stats.record_wakeup(end - start, pair.first != nullptr);
+		if (pair.first) {
+			auto selectable = static_cast<Selectable *>(pair.first);
+			auto &type = typeid(*selectable);
+			selectable->selected(selector, pair.second);
+			stats.record_dispatch(type, selectable, std::chrono::steady_clock::now() - end);
+		}
+	}
+}
+
+void Selectable::pump(Selector &selector, std::span<Selector::Event> events, ReactorStats &stats) {
+	for (;;) {
+		selector.run_posted();
+		selector.run_timers();
+		auto start = std::chrono::steady_clock::now();
+		auto ready = selector.select(events);
+		auto end = std::chrono::steady_clock::now();
+		// the kick that wakes us for posted tasks is reported as an event without a Selectable
+		stats.record_wakeup(end - start, std::count_if(ready.begin(), ready.end(), [](const Selector::Event &event) noexcept { return event.first != nullptr; }));
+		for (auto &event : ready) {
+			if (event.first) {
+				auto selectable = static_cast<Selectable *>(event.first);
+				auto &type = typeid(*selectable);
+				selectable->selected(selector, event.second);
+				start = std::exchange(end, std::chrono::steady_clock::now());
+				stats.record_dispatch(type, selectable, end - start);
+			}
+		}
+	}
+}
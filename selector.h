@@ -1,13 +1,35 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <chrono>
+#if __cpp_impl_coroutine >= 201902L
+#include <coroutine>
+#include <exception>
+#endif
 
 #include "enumflags.h"
 #include "fd.h"
 #include "signal.h"
+#include "smallfunction.h"
+#include "span.h"
+#include "timingwheel.h"
+
+#ifdef SELECTOR_IO_URING
+#include <thread>
+#include <vector>
+
+#include "linux_uring.h"
+#include "sync.h"
+#endif
 
 
 class Selectable;
+#if __cpp_impl_coroutine >= 201902L
+class SelectorAwaiter;
+class SelectorReadAwaiter;
+class SelectorWriteAwaiter;
+#endif
 
 
 class Selector {
@@ -17,39 +39,176 @@ public:
 		NONE = 0,
 		READABLE = 1 << 0,
 		WRITABLE = 1 << 1,
+		// registration modes; not reported by select
+		PERSISTENT = 1 << 2, // stay armed after each event (level-triggered); no need to call modify
+		EDGE_TRIGGERED = 1 << 3, // stay armed, but report only new readiness; handler must drain until EAGAIN
+	};
+
+	typedef std::pair<void *, Flags> Event;
+
+	struct BusyPollStats {
+		uint64_t spin_hits; // spins that found events before their budget ran out
+		uint64_t spin_misses; // spins that ran out of budget and fell back to a blocking wait
+		uint64_t blocking_waits; // waits that were allowed to block in the kernel
+	};
+
+	// A timeout that fires on the selecting thread. Timers may be armed and cancelled only on that thread.
+	class Timer : private TimingWheel::Entry {
+		friend Selector;
+	public:
+		virtual ~Timer() = default;
+	public:
+		using TimingWheel::Entry::armed;
+		using TimingWheel::Entry::cancel;
+	protected:
+		virtual void expired(Selector &selector) noexcept = 0;
 	};
 
 private:
-#ifdef __linux__
+	struct Posted {
+		Posted *next;
+		SmallFunction<void (void) noexcept> task;
+	};
+
+private:
+	std::atomic<Posted *> posted;
+	TimingWheel timers;
+	std::chrono::nanoseconds spin_budget, spin_current; // selecting thread only
+	std::atomic<int> socket_busy_poll; // read by add() on any thread
+	std::atomic<uint64_t> spin_hits, spin_misses, blocking_waits; // written only by the selecting thread
+#if defined(__linux__) && defined(SELECTOR_IO_URING)
+	// The kernel cancels a thread's io_uring requests when the thread exits, so only the selecting thread
+	// submits; add/modify/remove on other threads queue their entries under ring_mutex and kick it. Unlike
+	// an epoll registration, an armed poll keeps its file open, so a descriptor must be removed before it
+	// is closed unless it was registered one-shot and has since been reported.
+	struct Registration {
+		void *ptr;
+		uint32_t gen;
+		Flags flags;
+		bool armed;
+	};
+	mutex_t ring_mutex;
+	std::thread::id selecting_thread;
+	linux::IOURing ring;
+	FileDescriptor event_fd;
+	std::vector<Registration> registrations;
+	std::vector<int> rearm_fds;
+#elif defined(__linux__)
 	FileDescriptor epoll_fd, event_fd;
 #endif
 
 public:
 	Selector();
+	~Selector();
+
+private:
+	Selector(const Selector &) = delete;
+	Selector & operator=(const Selector &) = delete;
 
 public:
 	void add(FileDescriptor &fd, void *ptr, Flags flags);
 	void add(FileDescriptor &fd, Selectable *ptr, Flags flags) { return this->add(fd, static_cast<void *>(ptr), flags); }
 	void modify(FileDescriptor &fd, void *ptr, Flags flags);
 	void modify(FileDescriptor &fd, Selectable *ptr, Flags flags) { return this->modify(fd, static_cast<void *>(ptr), flags); }
+	void add_or_modify(FileDescriptor &fd, void *ptr, Flags flags);
+	void add_or_modify(FileDescriptor &fd, Selectable *ptr, Flags flags) { return this->add_or_modify(fd, static_cast<void *>(ptr), flags); }
 	void remove(FileDescriptor &fd);
 
-	std::pair<void *, Flags> select();
-	std::pair<void *, Flags> select(std::chrono::milliseconds timeout);
+	Event select();
+	Event select(std::chrono::milliseconds timeout);
+
+	Event pselect(const sigset_t *sigmask);
+	Event pselect(std::chrono::milliseconds timeout, const sigset_t *sigmask);
+
+	std::span<Event> select(std::span<Event> events);
+	std::span<Event> select(std::span<Event> events, std::chrono::milliseconds timeout);
 
-	std::pair<void *, Flags> pselect(const sigset_t *sigmask);
-	std::pair<void *, Flags> pselect(std::chrono::milliseconds timeout, const sigset_t *sigmask);
+	std::span<Event> pselect(std::span<Event> events, const sigset_t *sigmask);
+	std::span<Event> pselect(std::span<Event> events, std::chrono::milliseconds timeout, const sigset_t *sigmask);
 
 	void kick();
 
+	// Queues a task to be run on the selecting thread by run_posted(). May be called from any thread.
+	// Tasks must be noexcept, and an empty one throws std::bad_function_call here rather than there.
+	template <typename T>
+	void post(T &&task) {
+		decltype(Posted::task) f(std::forward<T>(task));
+		if (_unlikely(!f)) {
+			throw std::bad_function_call();
+		}
+		this->post(new Posted { nullptr, std::move(f) });
+	}
+
+	// Runs all posted tasks in the order they were posted. Returns whether any were run.
+	bool run_posted() noexcept;
+
+	// Timers bound the timeout of select, which returns no events when the nearest timer is due.
+	void arm(Timer &timer, std::chrono::steady_clock::time_point deadline) noexcept;
+	void arm(Timer &timer, std::chrono::steady_clock::duration delay) noexcept { this->arm(timer, std::chrono::steady_clock::now() + delay); }
+
+	// Fires all timers that are due. Returns whether any fired.
+	bool run_timers();
+
+	// Before blocking, select polls without a timeout for up to budget, halving the spin after each
+	// miss and restoring it after a hit. If socket_busy_poll is non-zero, it is applied as SO_BUSY_POLL
+	// (in microseconds) to sockets as they are added. A zero budget disables spinning. Like the timers,
+	// may be called only on the selecting thread, or before it starts selecting; busy_poll_stats() may
+	// be called on any thread.
+	void busy_poll(std::chrono::nanoseconds budget, std::chrono::microseconds socket_busy_poll = std::chrono::microseconds::zero()) noexcept;
+	BusyPollStats busy_poll_stats() const noexcept;
+
+#if __cpp_impl_coroutine >= 201902L
+	// Awaitables that suspend the calling coroutine until fd is ready and resume it from
+	// Selectable::pump. The awaiter lives in the coroutine frame, so awaiting does not allocate.
+	SelectorAwaiter readable(FileDescriptor &fd) noexcept;
+	SelectorAwaiter writable(FileDescriptor &fd) noexcept;
+	// resumes with the result of the first read of fd that does not return zero (EAGAIN)
+	SelectorReadAwaiter async_read(FileDescriptor &fd, void *buf, size_t n) noexcept;
+	// resumes with n after all n bytes have been written to fd
+	SelectorWriteAwaiter async_write(FileDescriptor &fd, const void *buf, size_t n) noexcept;
+#endif
+
+private:
+	int bound_timeout(int timeout) const noexcept;
+	std::span<Event> poll(std::span<Event> events, int timeout, const sigset_t *sigmask);
+	void post(Posted *posted);
+	std::span<Event> wait(std::span<Event> events, int timeout, const sigset_t *sigmask);
+#if defined(__linux__) && defined(SELECTOR_IO_URING)
+	bool _pure may_submit() const noexcept;
+	void make_room(std::unique_lock<mutex_t> &lock, unsigned n);
+	void queued(std::unique_lock<mutex_t> &lock);
+	struct io_uring_sqe * get_sqe();
+	void poll_arm(int fd, Registration &reg);
+	void poll_disarm(int fd, Registration &reg);
+#endif
+
 };
 DEFINE_ENUM_FLAG_OPS(Selector::Flags)
 
 
+class ReactorStats;
+
 class Selectable {
 
 public:
 	_noreturn static void pump(Selector &selector);
+	// Dispatches a whole batch of events per wakeup. A handler must not destroy any
+	// Selectable other than itself, as it may yet appear later in the same batch.
+	_noreturn static void pump(Selector &selector, std::span<Selector::Event> events);
+	// Returns once stop is set; whoever sets it should then post to selector to wake it.
+	static void pump(Selector &selector, std::span<Selector::Event> events, const std::atomic<bool> &stop);
+
+	template <size_t N>
+	_noreturn static void pump(Selector &selector) { std::array<Selector::Event, N> events; pump(selector, events); }
+	template <size_t N>
+	static void pump(Selector &selector, const std::atomic<bool> &stop) { std::array<Selector::Event, N> events; pump(selector, events, stop); }
+
+	// As above, but records dispatch times, events per wakeup, idle times and slow handlers into stats.
+	_noreturn static void pump(Selector &selector, ReactorStats &stats);
+	_noreturn static void pump(Selector &selector, std::span<Selector::Event> events, ReactorStats &stats);
+
+	template <size_t N>
+	_noreturn static void pump(Selector &selector, ReactorStats &stats) { std::array<Selector::Event, N> events; pump(selector, events, stats); }
 
 public:
 	virtual ~Selectable() = default;
@@ -58,3 +217,122 @@ protected:
 	virtual void selected(Selector &selector, Selector::Flags flags) noexcept = 0;
 
 };
+
+
+#if __cpp_impl_coroutine >= 201902L
+
+// A coroutine that starts eagerly and frees itself when it finishes, for per-connection handlers
+// driven by Selector awaitables. An exception escaping the coroutine terminates the process.
+struct SelectorTask {
+	struct promise_type {
+		SelectorTask get_return_object() noexcept { return { }; }
+		std::suspend_never initial_suspend() noexcept { return { }; }
+		std::suspend_never final_suspend() noexcept { return { }; }
+		void return_void() noexcept { }
+		_noreturn void unhandled_exception() noexcept { std::terminate(); }
+	};
+};
+
+
+class SelectorAwaiter : public Selectable {
+
+protected:
+	Selector &selector;
+	FileDescriptor &fd;
+	Selector::Flags flags;
+	std::coroutine_handle<> handle;
+	std::exception_ptr error;
+
+public:
+	SelectorAwaiter(Selector &selector, FileDescriptor &fd, Selector::Flags flags) noexcept : selector(selector), fd(fd), flags(flags) { }
+
+private:
+	SelectorAwaiter(const SelectorAwaiter &) = delete;
+	SelectorAwaiter & operator=(const SelectorAwaiter &) = delete;
+
+public:
+	constexpr bool await_ready() const noexcept { return false; }
+	void await_suspend(std::coroutine_handle<> handle) { this->handle = handle, selector.add_or_modify(fd, this, flags); }
+	Selector::Flags await_resume() const noexcept { return flags; }
+
+protected:
+	void selected(Selector &, Selector::Flags flags) noexcept override { this->flags = flags, handle.resume(); }
+
+	void rearm_or_resume() noexcept {
+		try {
+			return selector.add_or_modify(fd, this, flags);
+		}
+		catch (...) {
+			error = std::current_exception();
+		}
+		handle.resume();
+	}
+
+};
+
+
+class SelectorReadAwaiter : public SelectorAwaiter {
+
+private:
+	void *buf;
+	size_t n;
+	ssize_t r;
+
+public:
+	SelectorReadAwaiter(Selector &selector, FileDescriptor &fd, void *buf, size_t n) noexcept : SelectorAwaiter(selector, fd, Selector::Flags::READABLE), buf(buf), n(n), r() { }
+
+public:
+	bool await_ready() { return (r = fd.read(buf, n)) != 0 || n == 0; }
+	ssize_t await_resume() const { if (error) std::rethrow_exception(error); return r; }
+
+protected:
+	void selected(Selector &, Selector::Flags) noexcept override {
+		try {
+			if ((r = fd.read(buf, n)) == 0) {
+				return this->rearm_or_resume();
+			}
+		}
+		catch (...) {
+			error = std::current_exception();
+		}
+		handle.resume();
+	}
+
+};
+
+
+class SelectorWriteAwaiter : public SelectorAwaiter {
+
+private:
+	const void *buf;
+	size_t n, w;
+
+public:
+	SelectorWriteAwaiter(Selector &selector, FileDescriptor &fd, const void *buf, size_t n) noexcept : SelectorAwaiter(selector, fd, Selector::Flags::WRITABLE), buf(buf), n(n), w() { }
+
+public:
+	bool await_ready() { return (w += fd.write(buf, n)) == n; }
+	size_t await_resume() const { if (error) std::rethrow_exception(error); return w; }
+
+protected:
+	void selected(Selector &, Selector::Flags) noexcept override {
+		try {
+			if ((w += fd.write(static_cast<const std::byte *>(buf) + w, n - w)) < n) {
+				return this->rearm_or_resume();
+			}
+		}
+		catch (...) {
+			error = std::current_exception();
+		}
+		handle.resume();
+	}
+
+};
+
+
+inline SelectorAwaiter Selector::readable(FileDescriptor &fd) noexcept { return { *this, fd, Flags::READABLE }; }
+inline SelectorAwaiter Selector::writable(FileDescriptor &fd) noexcept { return { *this, fd, Flags::WRITABLE }; }
+inline SelectorReadAwaiter Selector::async_read(FileDescriptor &fd, void *buf, size_t n) noexcept { return { *this, fd, buf, n }; }
+inline SelectorWriteAwaiter Selector::async_write(FileDescriptor &fd, const void *buf, size_t n) noexcept { return { *this, fd, buf, n }; }
+
+#endif // __cpp_impl_coroutine >= 201902L
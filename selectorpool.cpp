@@ -0,0 +1,68 @@
+#include "selectorpool.h"
+
+#include <system_error>
+
+#include <pthread.h>
+#include <sched.h>
+
+
+static void pin_to_cpu(pthread_t thread, size_t index) {
+	cpu_set_t allowed;
+	if (_unlikely(::sched_getaffinity(0, sizeof allowed, &allowed) < 0)) {
+		throw std::system_error(errno, std::system_category(), "sched_getaffinity");
+	}
+	index %= CPU_COUNT(&allowed);
+	for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+		if (CPU_ISSET(cpu, &allowed) && index-- == 0) {
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(cpu, &set);
+			if (int error = ::pthread_setaffinity_np(thread, sizeof set, &set); _unlikely(error != 0)) {
+				throw std::system_error(error, std::system_category(), "pthread_setaffinity_np");
+			}
+			return;
+		}
+	}
+}
+
+
+SelectorPool::SelectorPool(size_t n) : n(n ?: 1), selectors(new Selector[this->n]), stopping() {
+}
+
+SelectorPool::~SelectorPool() {
+	stopping.store(true, std::memory_order_release);
+	for (size_t i = 0; i < n; ++i) {
+		selectors[i].post([]() noexcept { });
+	}
+	for (auto &thread : threads) {
+		thread.join();
+	}
+}
+
+void SelectorPool::start(bool pin) {
+	for (size_t i = 0; i < n; ++i) {
+		this->spawn(i, pin);
+	}
+}
+
+void SelectorPool::run(bool pin) {
+	for (size_t i = 1; i < n; ++i) {
+		this->spawn(i, pin);
+	}
+	if (pin) {
+		pin_to_cpu(::pthread_self(), 0);
+	}
+	Selectable::pump<batch_size>(selectors[0]);
+}
+
+void SelectorPool::spawn(size_t i, bool pin) {
+	auto &thread = threads.emplace_back(&SelectorPool::pump, this, i);
+	// pinned from here rather than from the thread itself, so that a failure throws to our caller
+	if (pin) {
+		pin_to_cpu(thread.native_handle(), i);
+	}
+}
+
+void SelectorPool::pump(size_t i) {
+	Selectable::pump<batch_size>(selectors[i], stopping);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "selector.h"
+#include "socket.h"
+
+
+class SelectorPool {
+
+private:
+	size_t n;
+	std::unique_ptr<Selector[]> selectors;
+	std::vector<std::unique_ptr<Selectable>> listeners;
+	std::atomic<bool> stopping;
+	std::vector<std::thread> threads;
+
+public:
+	explicit SelectorPool(size_t n = std::thread::hardware_concurrency());
+	// stops and joins the threads started by start() or run()
+	~SelectorPool();
+
+public:
+	size_t _pure size() const noexcept { return n; }
+	Selector & operator[](size_t i) noexcept { return selectors[i]; }
+
+	// Creates one Listener per shard, each bound to address with SO_REUSEPORT, so the kernel
+	// spreads incoming connections across the shards and each is accepted on its own thread.
+	template <typename Listener, typename... Args>
+	void listen(const SocketAddress &address, int backlog, Args &&...args) {
+		for (size_t i = 0; i < n; ++i) {
+			auto listener = std::make_unique<Listener>(args...);
+			listener->setsockopt(SOL_SOCKET, SO_REUSEPORT, 1);
+			listener->bind(address);
+			listener->listen(backlog);
+			selectors[i].add(*listener, static_cast<Selectable *>(listener.get()), Selector::Flags::READABLE);
+			listeners.emplace_back(std::move(listener));
+		}
+	}
+
+	// Pumps every shard on its own thread, optionally pinning shard i to the i-th usable CPU. Each
+	// wakeup dispatches a batch of up to batch_size events, so a handler must not destroy any
+	// Selectable but itself. Throws if a thread cannot be pinned; the threads already started are
+	// stopped when the pool is destroyed.
+	void start(bool pin = false);
+
+	// Pumps shards 1..n-1 on their own threads and shard 0 on the calling thread.
+	_noreturn void run(bool pin = false);
+
+private:
+	static constexpr size_t batch_size = 64;
+
+	void spawn(size_t i, bool pin);
+	void pump(size_t i);
+
+};
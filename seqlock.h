@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <type_traits>
+
+#include "compiler.h"
+#include "linux_sync.h"
+
+
+// A sequence lock for a trivially copyable payload that is read far more often than it is written.
+// Readers take no lock and write nothing: they copy the payload and retry if a writer was in the middle
+// of changing it. Writers are serialised by a futex mutex. The payload is copied a word at a time with
+// relaxed atomics, so a torn copy is merely discarded rather than being a data race.
+template <typename T>
+class SeqLock {
+	static_assert(std::is_trivially_copyable_v<T>);
+
+public:
+	static constexpr size_t cache_line = 64;
+
+private:
+	using word_t = unsigned long;
+	static constexpr size_t words = (sizeof(T) + sizeof(word_t) - 1) / sizeof(word_t);
+
+private:
+	alignas(cache_line) std::atomic<unsigned> seq;
+	word_t payload[words];
+	alignas(cache_line) linux::FutexMutex mutex;
+
+public:
+	SeqLock() noexcept(std::is_nothrow_default_constructible_v<T>) : SeqLock(T()) { }
+
+	explicit SeqLock(const T &value) noexcept : seq(), payload() {
+		std::memcpy(payload, &value, sizeof(T));
+	}
+
+private:
+	SeqLock(const SeqLock &) = delete;
+	SeqLock & operator=(const SeqLock &) = delete;
+
+public:
+	_nodiscard T load() const noexcept {
+		word_t copy[words];
+		for (unsigned s0 = seq.load(std::memory_order_acquire);;) {
+			if (_likely(!(s0 & 1))) {
+				for (size_t i = 0; i < words; ++i) {
+					copy[i] = __atomic_load_n(&payload[i], __ATOMIC_RELAXED);
+				}
+				std::atomic_thread_fence(std::memory_order_acquire);
+				unsigned s1 = seq.load(std::memory_order_relaxed);
+				if (_likely(s0 == s1)) {
+					break;
+				}
+				s0 = s1;
+			}
+			else {
+				_cpu_relax();
+				s0 = seq.load(std::memory_order_acquire);
+			}
+		}
+		return unpack(copy);
+	}
+
+	void store(const T &value) {
+		std::lock_guard<linux::FutexMutex> lock(mutex);
+		this->write(value);
+	}
+
+	// replaces the payload with the result of f(current) and returns it, atomically with respect to other writers
+	template <typename F>
+	T update(F &&f) {
+		std::lock_guard<linux::FutexMutex> lock(mutex);
+		const T current = unpack(payload);
+		T value = std::forward<F>(f)(current);
+		this->write(value);
+		return value;
+	}
+
+private:
+	// T need not be default constructible: copying its bytes into suitable storage creates it there
+	static T unpack(const word_t *copy) noexcept {
+		alignas(T) std::byte bytes[sizeof(T)];
+		std::memcpy(bytes, copy, sizeof(T));
+		return *std::launder(reinterpret_cast<T *>(bytes));
+	}
+
+	void write(const T &value) noexcept {
+		word_t copy[words] = { };
+		std::memcpy(copy, &value, sizeof(T));
+		unsigned s = seq.load(std::memory_order_relaxed);
+		seq.store(s + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		for (size_t i = 0; i < words; ++i) {
+			__atomic_store_n(&payload[i], copy[i], __ATOMIC_RELAXED);
+		}
+		seq.store(s + 2, std::memory_order_release);
+	}
+
+};
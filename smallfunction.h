@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "compiler.h"
+
+
+template <size_t Capacity, bool Noexcept, typename R, typename... Args>
+class _SmallFunction;
+
+template <typename Signature, size_t Capacity>
+struct _SmallFunctionOf;
+
+template <typename R, typename... Args, size_t Capacity>
+struct _SmallFunctionOf<R (Args...), Capacity> { typedef _SmallFunction<Capacity, false, R, Args...> type; };
+
+template <typename R, typename... Args, size_t Capacity>
+struct _SmallFunctionOf<R (Args...) noexcept, Capacity> { typedef _SmallFunction<Capacity, true, R, Args...> type; };
+
+// A move-only std::function that stores its target inline and never allocates. A target that does not
+// fit in Capacity bytes is a compile-time error; wrap it with SmallFunction::boxed to put it on the heap
+// explicitly. Targets must be nothrow move constructible, so moving a SmallFunction is noexcept. With a
+// noexcept signature, such as void () noexcept, targets must also be nothrow invocable, and so is the
+// SmallFunction; calling an empty one then terminates rather than throwing std::bad_function_call.
+template <typename Signature, size_t Capacity = 48>
+using SmallFunction = typename _SmallFunctionOf<Signature, Capacity>::type;
+
+template <size_t Capacity, bool Noexcept, typename R, typename... Args>
+class _SmallFunction {
+
+private:
+	struct VTable {
+		R (*invoke)(void *target, Args &&...args) noexcept(Noexcept);
+		void (*relocate)(void *to, void *from) noexcept;
+		void (*destroy)(void *target) noexcept;
+	};
+
+	template <typename F>
+	static constexpr VTable vtable_for = {
+		[](void *target, Args &&...args) noexcept(Noexcept) -> R { return std::invoke(*static_cast<F *>(target), std::forward<Args>(args)...); },
+		[](void *to, void *from) noexcept { ::new (to) F(std::move(*static_cast<F *>(from))), static_cast<F *>(from)->~F(); },
+		[](void *target) noexcept { static_cast<F *>(target)->~F(); },
+	};
+
+	template <typename F>
+	static constexpr bool fits = sizeof(F) <= Capacity && alignof(F) <= alignof(std::max_align_t);
+
+	template <typename F>
+	static constexpr bool invocable = Noexcept ? std::is_nothrow_invocable_r_v<R, F &, Args...> : std::is_invocable_r_v<R, F &, Args...>;
+
+private:
+	alignas(std::max_align_t) std::byte storage[Capacity];
+	const VTable *vtable;
+
+public:
+	_SmallFunction() noexcept : vtable() { }
+	_SmallFunction(std::nullptr_t) noexcept : vtable() { }
+
+	template <typename F, typename D = std::decay_t<F>, typename = std::enable_if_t<!std::is_same_v<D, _SmallFunction> && invocable<D>>>
+	_SmallFunction(F &&f) noexcept(std::is_nothrow_constructible_v<D, F>) {
+		static_assert(fits<D>, "target does not fit in SmallFunction; increase its capacity or use SmallFunction::boxed");
+		static_assert(std::is_nothrow_move_constructible_v<D>, "target of SmallFunction must be nothrow move constructible");
+		::new (static_cast<void *>(storage)) D(std::forward<F>(f));
+		vtable = &vtable_for<D>;
+	}
+
+	_SmallFunction(_SmallFunction &&move) noexcept : vtable(move.vtable) {
+		if (vtable) {
+			vtable->relocate(storage, move.storage), move.vtable = nullptr;
+		}
+	}
+
+	_SmallFunction & operator=(_SmallFunction &&move) noexcept {
+		if (this != &move) {
+			this->reset();
+			if ((vtable = move.vtable)) {
+				vtable->relocate(storage, move.storage), move.vtable = nullptr;
+			}
+		}
+		return *this;
+	}
+
+	_SmallFunction & operator=(std::nullptr_t) noexcept { return this->reset(), *this; }
+
+	~_SmallFunction() { this->reset(); }
+
+private:
+	_SmallFunction(const _SmallFunction &) = delete;
+	_SmallFunction & operator=(const _SmallFunction &) = delete;
+
+public:
+	explicit _pure operator bool () const noexcept { return vtable; }
+
+	// throws std::bad_function_call if empty, or terminates if the signature is noexcept
+	R operator()(Args... args) noexcept(Noexcept) {
+		if (_unlikely(!vtable)) {
+			if constexpr (Noexcept) {
+				std::terminate();
+			}
+			else {
+				throw std::bad_function_call();
+			}
+		}
+		return vtable->invoke(storage, std::forward<Args>(args)...);
+	}
+
+	void swap(_SmallFunction &other) noexcept { _SmallFunction temp(std::move(other)); other = std::move(*this), *this = std::move(temp); }
+	friend void swap(_SmallFunction &lhs, _SmallFunction &rhs) noexcept { lhs.swap(rhs); }
+
+	// the explicit fallback for targets too large to store inline: one allocation, here and now
+	template <typename F>
+	static _SmallFunction boxed(F &&f) {
+		return [target = std::make_unique<std::decay_t<F>>(std::forward<F>(f))](Args... args) noexcept(std::is_nothrow_invocable_v<std::decay_t<F> &, Args...>) -> R { return std::invoke(*target, std::forward<Args>(args)...); };
+	}
+
+private:
+	void reset() noexcept {
+		if (vtable) {
+			vtable->destroy(storage), vtable = nullptr;
+		}
+	}
+
+};
@@ -0,0 +1,20 @@
+#pragma once
+
+// The mutex and condition variable used inside the library. Define SYNC_FUTEX to use the futex
+// primitives from linux_sync.h in place of the standard library's.
+#if defined(__linux__) && defined(SYNC_FUTEX)
+
+#include "linux_sync.h"
+
+typedef linux::FutexMutex mutex_t;
+typedef linux::FutexCondition condition_variable_t;
+
+#else
+
+#include <condition_variable>
+#include <mutex>
+
+typedef std::mutex mutex_t;
+typedef std::condition_variable condition_variable_t;
+
+#endif
@@ -0,0 +1,95 @@
+#include "../bufferchain.h"
+
+#include <cassert>
+#include <cstring>
+#include <string>
+
+static std::string contents(const BufferChain &chain) {
+	std::string s;
+	for (auto &buf : chain.buffers()) {
+		s.append(static_cast<const char *>(buf.ptr), buf.size);
+	}
+	assert(s.size() == chain.size());
+	return s;
+}
+
+static DynamicBuffer make_buffer(const char *s) {
+	DynamicBuffer buffer(std::strlen(s));
+	std::memcpy(buffer.pptr, s, std::strlen(s)), buffer.pbump(std::strlen(s));
+	return buffer;
+}
+
+static const char hello[] = "Hello, ";
+
+// borrowed, owned and copied segments, with adjacent copies packed into one
+static BufferChain build() {
+	BufferChain chain;
+	chain.append(hello, 7);
+	chain.append(make_buffer("brave new "));
+	chain.append_copy("world", 5);
+	chain.append_copy("!", 1);
+	chain.prepend_copy("> ", 2);
+	chain.prepend("[", 1);
+	return chain;
+}
+
+// takes at most four bytes from each call
+struct Output {
+	std::string written;
+	size_t write(std::span<const ConstBufferPointer> bufs) {
+		size_t n = 0;
+		for (auto &buf : bufs) {
+			size_t m = std::min(buf.size, 4 - n);
+			written.append(static_cast<const char *>(buf.ptr), m), n += m;
+			if (n == 4) {
+				break;
+			}
+		}
+		return n;
+	}
+};
+
+int main() {
+	const std::string full = "[> Hello, brave new world!";
+	BufferChain chain = build();
+	assert(contents(chain) == full && chain.buffers().size() == 5 && chain.iovecs().size() == 5);
+	struct msghdr message = chain.msghdr();
+	assert(message.msg_iovlen == 5 && message.msg_iov[2].iov_base == hello && !message.msg_name);
+
+	// splitting and consuming at every offset, both on and between segment boundaries
+	for (size_t n = 0; n <= full.size() + 1; ++n) {
+		BufferChain back = build();
+		BufferChain front = back.split(n);
+		assert(contents(front) == full.substr(0, n) && contents(back) == full.substr(std::min(n, full.size())));
+		// then split what is left again, so that a segment is cut twice
+		BufferChain middle = back.split(3);
+		assert(contents(front) + contents(middle) + contents(back) == full);
+		front.append(std::move(middle));
+		front.append(std::move(back));
+		assert(contents(front) == full && back.empty());
+
+		BufferChain consumed = build();
+		consumed.consume(n);
+		assert(contents(consumed) == full.substr(std::min(n, full.size())));
+		consumed.consume(1);
+		consumed.prepend_copy("x", 1);
+		std::string rest = contents(consumed);
+		assert(rest[0] == 'x' && rest.substr(1) == full.substr(std::min(n + 1, full.size())));
+	}
+
+	// a split keeps the owned memory it refers to alive after the rest of the chain is gone
+	BufferChain front = chain.split(15);
+	chain.clear();
+	assert(contents(front) == full.substr(0, 15));
+	front.clear();
+	assert(front.empty() && front.buffers().empty());
+
+	Output output;
+	chain = build();
+	while (!chain.empty()) {
+		size_t remaining = chain.size();
+		assert(chain.write_to(output) == std::min<size_t>(4, remaining) && chain.size() == remaining - std::min<size_t>(4, remaining));
+	}
+	assert(output.written == full);
+	return 0;
+}
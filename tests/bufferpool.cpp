@@ -0,0 +1,104 @@
+#include "../bufferpool.h"
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "../linux_sync.h"
+
+static constexpr size_t page = BufferPool::min_class_size;
+
+static void cross_thread(BufferPool &pool, size_t n, size_t size) {
+	// allocated on one thread and freed on another, which passes them back through the shared lists when it exits
+	std::vector<void *> buffers;
+	std::thread([&] {
+		for (size_t i = 0; i < n; ++i) {
+			void *ptr = pool.allocate(size);
+			assert(reinterpret_cast<uintptr_t>(ptr) % page == 0);
+			std::memset(ptr, static_cast<int>(i), size);
+			buffers.push_back(ptr);
+		}
+	}).join();
+	std::thread([&]() noexcept {
+		for (void *ptr : buffers) {
+			pool.deallocate(ptr, size);
+		}
+	}).join();
+}
+
+int main() {
+	assert(BufferPool::round_size(1) == page && BufferPool::round_size(page + 1) == 2 * page);
+	assert(BufferPool::round_size(BufferPool::max_class_size + 1) == BufferPool::max_class_size + page);
+	{
+		BufferPool pool;
+		cross_thread(pool, 32, 100);
+		auto stats = pool.stats();
+		assert(stats.in_use == 0 && stats.high_water == 32 * page && stats.cached == 32 * page && stats.reserved == 32 * page);
+
+		// the freed buffers are reused rather than reserving more
+		std::vector<void *> buffers;
+		for (int i = 0; i < 32; ++i) {
+			buffers.push_back(pool.allocate(page));
+		}
+		stats = pool.stats();
+		assert(stats.in_use == 32 * page && stats.cached == 0 && stats.reserved == 32 * page);
+		for (void *ptr : buffers) {
+			pool.deallocate(ptr, page);
+		}
+		pool.trim();
+		stats = pool.stats();
+		assert(stats.in_use == 0 && stats.high_water == 32 * page && stats.cached == 0 && stats.reserved == 0);
+
+		// trim cannot reach another thread's cache until that thread exits
+		linux::FutexEvent trimmed;
+		std::thread holder([&] {
+			void *ptr = pool.allocate(2 * page);
+			pool.deallocate(ptr, 2 * page);
+			trimmed.wait();
+		});
+		while (pool.stats().cached != 2 * page) {
+			std::this_thread::yield();
+		}
+		pool.trim();
+		stats = pool.stats();
+		assert(stats.cached == 2 * page && stats.reserved == 2 * page);
+		trimmed.set();
+		holder.join();
+		pool.trim();
+		stats = pool.stats();
+		assert(stats.cached == 0 && stats.reserved == 0);
+
+		// sizes beyond the largest class bypass the lists
+		size_t large = BufferPool::max_class_size + 1;
+		void *ptr = pool.allocate(large);
+		stats = pool.stats();
+		assert(stats.in_use == BufferPool::round_size(large) && stats.cached == 0 && stats.reserved == BufferPool::round_size(large));
+		pool.deallocate(ptr, large);
+		stats = pool.stats();
+		assert(stats.in_use == 0 && stats.reserved == 0);
+	}
+	{
+		// with no thread cache, every free goes straight to the shared lists, where trim can reach it
+		BufferPool pool(false, 0);
+		pool.deallocate(pool.allocate(page), page);
+		void *a = pool.allocate(page), *b = pool.allocate(page);
+		pool.deallocate(a, page), pool.deallocate(b, page);
+		auto stats = pool.stats();
+		assert(stats.in_use == 0 && stats.cached == 2 * page && stats.reserved == 2 * page);
+		std::thread([&]() noexcept { pool.trim(); }).join();
+		stats = pool.stats();
+		assert(stats.cached == 0 && stats.reserved == 0);
+	}
+	{
+		// slabs are kept until the pool is destroyed, even across threads that have exited
+		BufferPool pool(true);
+		cross_thread(pool, 64, 3 * page);
+		auto stats = pool.stats();
+		assert(stats.in_use == 0 && stats.cached == 64 * 4 * page && stats.reserved == BufferPool::huge_page_size);
+		pool.trim();
+		assert(pool.stats().reserved == BufferPool::huge_page_size);
+	}
+	return 0;
+}
@@ -0,0 +1,127 @@
+#include "../rcu.h"
+#include "../seqlock.h"
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+// a grace period lasts until the outermost of a reader's nested critical sections ends
+static void grace_period() {
+	RcuDomain domain;
+	std::atomic<int> stage { };
+	std::atomic<bool> synchronized { }, freed { };
+	std::thread reader([&] {
+		RcuDomain::Reader r(domain);
+		{
+			RcuDomain::ReadLock outer(r);
+			{
+				RcuDomain::ReadLock inner(r);
+				stage = 1;
+				while (stage != 2) {
+					std::this_thread::sleep_for(1ms);
+				}
+			}
+			// leaving the inner section must not end the grace period
+			std::this_thread::sleep_for(50ms);
+			assert(!synchronized && !freed);
+		}
+	});
+	while (stage != 1) {
+		std::this_thread::sleep_for(1ms);
+	}
+	domain.retire(new int(0), [](void *p) { delete static_cast<int *>(p); });
+	std::thread writer([&] {
+		domain.synchronize();
+		synchronized = true;
+	});
+	std::thread reclaimer([&] {
+		domain.retire(new bool(false), [](void *p) { delete static_cast<bool *>(p); });
+		domain.reclaim();
+		freed = true;
+	});
+	std::this_thread::sleep_for(20ms);
+	assert(!synchronized && !freed);
+	stage = 2;
+	writer.join(), reclaimer.join(), reader.join();
+	assert(synchronized && freed);
+}
+
+// readers never see an object that a writer has replaced and the domain has freed
+static void pointer() {
+	struct Node {
+		int value, check;
+		Node(int value) noexcept : value(value), check(~value) { }
+		~Node() { check = value; }
+	};
+	RcuDomain domain;
+	{
+		RcuPointer<Node> ptr(domain, new Node(0));
+		std::atomic<bool> done { };
+		std::vector<std::thread> readers;
+		for (int t = 0; t < 3; ++t) {
+			readers.emplace_back([&] {
+				RcuDomain::Reader r(domain);
+				int last = 0;
+				while (!done.load(std::memory_order_relaxed)) {
+					RcuDomain::ReadLock lock(r);
+					RcuDomain::ReadLock nested(r);
+					const Node *node = ptr.load(lock);
+					assert(node->check == ~node->value && node->value >= last);
+					last = node->value;
+				}
+			});
+		}
+		for (int i = 1; i <= 20000; ++i) {
+			ptr.store(new Node(i));
+		}
+		done = true;
+		for (auto &reader : readers) {
+			reader.join();
+		}
+	}
+}
+
+// readers never see a torn value, and see each writer's updates in order
+static void seqlock() {
+	struct Pair {
+		unsigned long a, b, c;
+	};
+	SeqLock<Pair> lock(Pair { 0, ~0ul, 0 });
+	std::atomic<bool> done { };
+	std::vector<std::thread> readers;
+	for (int t = 0; t < 2; ++t) {
+		readers.emplace_back([&]() noexcept {
+			unsigned long last = 0;
+			while (!done.load(std::memory_order_relaxed)) {
+				Pair p = lock.load();
+				assert(p.b == ~p.a && p.c == p.a * 3 && p.a >= last);
+				last = p.a;
+			}
+		});
+	}
+	for (unsigned long i = 1; i <= 100000; ++i) {
+		if (i % 2) {
+			lock.store({ i, ~i, i * 3 });
+		}
+		else {
+			Pair p = lock.update([](const Pair &current) { return Pair { current.a + 1, ~(current.a + 1), (current.a + 1) * 3 }; });
+			assert(p.a == i);
+		}
+	}
+	done = true;
+	for (auto &reader : readers) {
+		reader.join();
+	}
+	assert(lock.load().a == 100000);
+}
+
+int main() {
+	grace_period();
+	pointer();
+	seqlock();
+	return 0;
+}
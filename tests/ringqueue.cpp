@@ -0,0 +1,115 @@
+#include "../ringqueue.h"
+
+#include <cassert>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+template <bool SPSC>
+static void wraparound() {
+	RingQueue<std::unique_ptr<int>, SPSC> queue(3);
+	assert(queue.capacity() == 4);
+	std::unique_ptr<int> value;
+	assert(!queue.try_pop(value));
+	// many laps around the ring, leaving it neither full nor empty where it wraps
+	for (int lap = 0; lap < 100; ++lap) {
+		for (int i = 0; i < 3; ++i) {
+			assert(queue.try_push(std::make_unique<int>(lap * 3 + i)));
+		}
+		for (int i = 0; i < 3; ++i) {
+			assert(queue.try_pop(value) && *value == lap * 3 + i);
+		}
+	}
+	for (int i = 0; i < 4; ++i) {
+		assert(queue.try_push(std::make_unique<int>(i)));
+	}
+	auto extra = std::make_unique<int>(4);
+	assert(!queue.try_push(std::move(extra)) && extra); // full, and extra was not moved from
+	std::unique_ptr<int> batch[8];
+	assert(queue.try_pop(std::span<std::unique_ptr<int>>(batch)) == 4);
+	for (int i = 0; i < 4; ++i) {
+		assert(*batch[i] == i);
+	}
+	for (int i = 0; i < 8; ++i) {
+		batch[i] = std::make_unique<int>(i);
+	}
+	assert(queue.try_push(std::span<std::unique_ptr<int>>(batch)) == 4); // as many as fit
+	assert(!batch[0] && batch[4]);
+	// the destructor frees the four left in the queue
+}
+
+// a consumer parked on an empty queue and a producer parked on a full one are both woken
+template <bool SPSC>
+static void parking() {
+	RingQueue<int, SPSC> queue(2);
+	std::thread consumer([&] {
+		assert(queue.pop() == 0);
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	queue.push(0);
+	consumer.join();
+
+	queue.push(1), queue.push(2);
+	std::thread producer([&] {
+		queue.push(3);
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	assert(queue.pop() == 1);
+	producer.join();
+	assert(queue.pop() == 2 && queue.pop() == 3);
+}
+
+// every value pushed by any producer is popped exactly once, and each producer's values in order
+template <bool SPSC>
+static void transfer(unsigned producers, unsigned consumers) {
+	static constexpr int per_producer = 100000;
+	RingQueue<int, SPSC> queue(64);
+	std::vector<std::thread> threads;
+	std::vector<long long> sums(consumers);
+	for (unsigned p = 0; p < producers; ++p) {
+		threads.emplace_back([&queue, p] {
+			int values[7];
+			for (int i = 0; i < per_producer; i += 7) {
+				int n = std::min(7, per_producer - i);
+				for (int j = 0; j < n; ++j) {
+					values[j] = static_cast<int>(p) * per_producer + i + j;
+				}
+				queue.push(std::span(values, n));
+			}
+		});
+	}
+	for (unsigned c = 0; c < consumers; ++c) {
+		threads.emplace_back([&, c] {
+			std::vector<int> last(producers, -1);
+			for (int n = 0; n < static_cast<int>(producers) * per_producer / static_cast<int>(consumers);) {
+				int values[5];
+				size_t m = queue.pop(std::span(values, std::min(5, static_cast<int>(producers) * per_producer / static_cast<int>(consumers) - n)));
+				for (size_t j = 0; j < m; ++j) {
+					int p = values[j] / per_producer, i = values[j] % per_producer;
+					assert(i > last[p]);
+					last[p] = i, sums[c] += values[j];
+				}
+				n += static_cast<int>(m);
+			}
+		});
+	}
+	for (auto &thread : threads) {
+		thread.join();
+	}
+	long long total = 0, n = static_cast<long long>(producers) * per_producer;
+	for (long long sum : sums) {
+		total += sum;
+	}
+	assert(total == n * (n - 1) / 2);
+}
+
+int main() {
+	wraparound<false>();
+	wraparound<true>();
+	parking<false>();
+	parking<true>();
+	transfer<false>(3, 2);
+	transfer<true>(1, 1);
+	return 0;
+}
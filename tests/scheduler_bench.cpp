@@ -0,0 +1,108 @@
+// Schedules a million timers from several threads on the timing-wheel Scheduler and on the heap-based
+// scheduler that it replaced, reproduced below, and reports the cost of scheduling and how late they ran.
+
+#include "../scheduler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock clock_type;
+
+static constexpr size_t timers = 1000000, threads = 4;
+
+class HeapScheduler {
+
+private:
+	struct Work {
+		clock_type::time_point deadline;
+		std::function<void (void)> task;
+		bool _pure operator>(const Work &other) const noexcept { return deadline > other.deadline; }
+	};
+
+private:
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::priority_queue<Work, std::vector<Work>, std::greater<Work>> queue;
+
+public:
+	_noreturn void run() {
+		std::unique_lock<std::mutex> lock(mutex);
+		for (;;) {
+			if (queue.empty()) {
+				condition.wait(lock);
+			}
+			else if (auto &work = queue.top(); clock_type::now() < work.deadline) {
+				condition.wait_until(lock, work.deadline);
+			}
+			else {
+				auto task = std::move(const_cast<Work &>(work).task);
+				queue.pop();
+				lock.unlock();
+				task();
+				lock.lock();
+			}
+		}
+	}
+
+	template <typename T>
+	void call_at(clock_type::time_point deadline, T &&task) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (queue.empty() || deadline < queue.top().deadline) {
+			condition.notify_one();
+		}
+		queue.push({ deadline, std::forward<T>(task) });
+	}
+
+};
+
+struct Lateness {
+	std::atomic<size_t> count;
+	std::atomic<int64_t> total_us, max_us;
+};
+
+template <typename S>
+static void run(const char *name) {
+	// neither scheduler can be stopped, so leave it and its thread running
+	S *scheduler = new S;
+	std::thread(&S::run, scheduler).detach();
+	Lateness lateness { };
+	auto base = clock_type::now() + std::chrono::milliseconds(500);
+	auto start = clock_type::now();
+	std::vector<std::thread> producers;
+	for (size_t t = 0; t < threads; ++t) {
+		producers.emplace_back([&, t] {
+			std::minstd_rand rand(static_cast<unsigned>(t));
+			std::uniform_int_distribution<int> spread(0, 1000);
+			for (size_t i = 0; i < timers / threads; ++i) {
+				auto deadline = base + std::chrono::milliseconds(spread(rand));
+				scheduler->call_at(deadline, [&lateness, deadline]() noexcept {
+					int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(clock_type::now() - deadline).count();
+					lateness.total_us.fetch_add(us, std::memory_order_relaxed);
+					for (int64_t max = lateness.max_us.load(std::memory_order_relaxed); us > max && !lateness.max_us.compare_exchange_weak(max, us, std::memory_order_relaxed););
+					lateness.count.fetch_add(1, std::memory_order_release);
+				});
+			}
+		});
+	}
+	for (auto &producer : producers) {
+		producer.join();
+	}
+	std::chrono::duration<double, std::nano> scheduling = clock_type::now() - start;
+	while (lateness.count.load(std::memory_order_acquire) < timers) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	std::printf("%s: %.0f ns per call_at, lateness mean %.0f us, max %ld us\n", name, scheduling.count() / timers,
+			static_cast<double>(lateness.total_us.load()) / timers, static_cast<long>(lateness.max_us.load()));
+}
+
+int main() {
+	run<HeapScheduler>("heap");
+	run<Scheduler<clock_type>>("timing wheel");
+	return 0;
+}
@@ -0,0 +1,95 @@
+// Build once as is and once with -DSELECTOR_IO_URING to compare the epoll and io_uring backends.
+
+#include "../selector.h"
+
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+
+#include <sys/socket.h>
+
+#ifdef SELECTOR_IO_URING
+static constexpr const char backend[] = "io_uring";
+#else
+static constexpr const char backend[] = "epoll";
+#endif
+
+static constexpr size_t pairs = 1024, batch = 64, rounds = 20000;
+
+struct Pair {
+	FileDescriptor reader, writer;
+};
+
+static std::unique_ptr<Pair[]> make_pairs() {
+	auto p = std::make_unique<Pair[]>(pairs);
+	for (size_t i = 0; i < pairs; ++i) {
+		int sv[2];
+		if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sv) < 0) {
+			std::perror("socketpair");
+			std::exit(1);
+		}
+		p[i].reader = FileDescriptor(sv[0]), p[i].writer = FileDescriptor(sv[1]);
+	}
+	return p;
+}
+
+// each round makes batch sockets readable and selects until it has drained them all
+static void run(const char *mode, Selector::Flags flags) {
+	Selector selector;
+	auto p = make_pairs();
+	for (size_t i = 0; i < pairs; ++i) {
+		selector.add(p[i].reader, &p[i], flags);
+	}
+	Selector::Event events[batch];
+	char c = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (size_t r = 0, next = 0; r < rounds; ++r) {
+		for (size_t i = 0; i < batch; ++i) {
+			_unused size_t w = p[(next + i * 7) % pairs].writer.write(&c, 1);
+		}
+		next += batch;
+		for (size_t seen = 0; seen < batch; ) {
+			for (auto &event : selector.select(events)) {
+				if (Pair *pair = static_cast<Pair *>(event.first)) {
+					_unused ssize_t n = pair->reader.read(&c, 1);
+					if ((flags & (Selector::Flags::PERSISTENT | Selector::Flags::EDGE_TRIGGERED)) == Selector::Flags::NONE) {
+						selector.modify(pair->reader, pair, flags);
+					}
+					++seen;
+				}
+			}
+		}
+	}
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+	std::printf("%s %s: %.0f ns/event\n", backend, mode, elapsed.count() / (rounds * batch));
+}
+
+// a registration made on another thread while the selecting thread sleeps takes effect at once
+static void cross_thread() {
+	Selector selector;
+	auto p = make_pairs();
+	std::thread thread([&] {
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		selector.add(p[0].reader, &p[0], Selector::Flags::READABLE);
+		char c = 0;
+		_unused size_t w = p[0].writer.write(&c, 1);
+	});
+	Selector::Event event;
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+	do {
+		event = selector.select(std::chrono::milliseconds(100));
+	} while (!event.first && std::chrono::steady_clock::now() < deadline);
+	thread.join();
+	assert(event.first == &p[0]);
+	std::printf("%s cross-thread add: %s\n", backend, event.first == &p[0] ? "ok" : "FAILED");
+}
+
+int main() {
+	run("one-shot", Selector::Flags::READABLE);
+	run("persistent", Selector::Flags::READABLE | Selector::Flags::PERSISTENT);
+	run("edge-triggered", Selector::Flags::READABLE | Selector::Flags::EDGE_TRIGGERED);
+	cross_thread();
+	return 0;
+}
@@ -0,0 +1,71 @@
+#include "../smallfunction.h"
+
+#include <array>
+#include <cassert>
+#include <memory>
+#include <string>
+
+struct Counted {
+	static inline int live = 0;
+	Counted() noexcept { ++live; }
+	Counted(const Counted &) noexcept { ++live; }
+	Counted(Counted &&) noexcept { ++live; }
+	~Counted() { --live; }
+	int operator()(int x) const noexcept { return x + 1; }
+};
+
+int main() {
+	SmallFunction<int (int)> empty;
+	assert(!empty);
+	bool threw = false;
+	try {
+		empty(1);
+	}
+	catch (const std::bad_function_call &) {
+		threw = true;
+	}
+	assert(threw);
+
+	// move-only targets, moved along with the function; the moved-from function is empty
+	auto owned = std::make_unique<int>(41);
+	SmallFunction<int (int)> f = [owned = std::move(owned)](int x) noexcept { return *owned + x; };
+	assert(f && f(1) == 42);
+	SmallFunction<int (int)> g = std::move(f);
+	assert(!f && g(2) == 43);
+	f = std::move(g);
+	assert(f && !g && f(0) == 41);
+
+	// targets are destroyed exactly once, whether reset, reassigned, swapped or destroyed
+	{
+		SmallFunction<int (int)> a = Counted(), b = Counted();
+		assert(Counted::live == 2);
+		swap(a, b);
+		assert(Counted::live == 2 && a(1) == 2 && b(2) == 3);
+		a = nullptr;
+		assert(Counted::live == 1 && !a);
+		b = std::move(f);
+		assert(Counted::live == 0 && b(1) == 42);
+		a = Counted();
+		assert(Counted::live == 1);
+	}
+	assert(Counted::live == 0);
+
+	// rvalue and reference parameters are forwarded as such
+	SmallFunction<std::string (std::string &&, const std::string &)> concat = [](std::string &&a, const std::string &b) { return std::move(a) + b; };
+	assert(concat("foo", "bar") == "foobar");
+
+	// a target too large to store inline can be boxed explicitly
+	std::array<long, 32> big { };
+	big[31] = 7;
+	auto boxed = SmallFunction<long ()>::boxed([big]() noexcept { return big[31]; });
+	SmallFunction<long ()> moved = std::move(boxed);
+	assert(moved() == 7);
+
+	// a noexcept signature accepts only nothrow targets and is itself nothrow to call
+	SmallFunction<int (int) noexcept> nothrow = Counted();
+	static_assert(noexcept(nothrow(1)) && !noexcept(empty(1)));
+	static_assert(!std::is_constructible_v<SmallFunction<void () noexcept>, void (*)()>);
+	static_assert(std::is_constructible_v<SmallFunction<void ()>, void (*)()>);
+	assert(nothrow(1) == 2);
+	return 0;
+}
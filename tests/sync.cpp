@@ -0,0 +1,173 @@
+#include "../linux_futex.h"
+#include "../linux_sync.h"
+
+#include <cassert>
+#include <chrono>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+static void mutex() {
+	linux::FutexMutex mutex;
+	long counter = 0;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t) {
+		threads.emplace_back([&] {
+			for (int i = 0; i < 100000; ++i) {
+				std::lock_guard<linux::FutexMutex> lock(mutex);
+				++counter;
+			}
+		});
+	}
+	for (auto &thread : threads) {
+		thread.join();
+	}
+	assert(counter == 400000);
+	assert(mutex.try_lock());
+	std::thread([&]() noexcept { assert(!mutex.try_lock()); }).join();
+	mutex.unlock();
+}
+
+static void condition() {
+	linux::FutexMutex mutex;
+	linux::FutexCondition condition;
+	int turn = 0;
+	std::thread other([&] {
+		std::unique_lock<linux::FutexMutex> lock(mutex);
+		for (int i = 0; i < 1000; ++i) {
+			condition.wait(lock, [&] { return turn % 2 == 1; });
+			++turn, condition.notify_one();
+		}
+	});
+	{
+		std::unique_lock<linux::FutexMutex> lock(mutex);
+		for (int i = 0; i < 1000; ++i) {
+			condition.wait(lock, [&] { return turn % 2 == 0; });
+			++turn, condition.notify_one();
+		}
+	}
+	other.join();
+	assert(turn == 2000);
+	std::unique_lock<linux::FutexMutex> lock(mutex);
+	auto start = std::chrono::steady_clock::now();
+	assert(!condition.wait_for(lock, 20ms, [] { return false; }));
+	assert(std::chrono::steady_clock::now() - start >= 20ms && lock.owns_lock());
+}
+
+// notifiers that change the predicate under the lock but notify after releasing it, as Executor does;
+// a lost wakeup leaves a consumer asleep with work queued and the test hangs
+static void unlocked_notify() {
+	static constexpr int producers = 3, consumers = 3, per_producer = 20000;
+	linux::FutexMutex mutex;
+	linux::FutexCondition condition;
+	int queued = 0, taken = 0;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < producers; ++t) {
+		threads.emplace_back([&] {
+			for (int i = 0; i < per_producer; ++i) {
+				{
+					std::lock_guard<linux::FutexMutex> lock(mutex);
+					++queued;
+				}
+				i % 64 == 63 ? condition.notify_all() : condition.notify_one();
+			}
+		});
+	}
+	for (int t = 0; t < consumers; ++t) {
+		threads.emplace_back([&] {
+			std::unique_lock<linux::FutexMutex> lock(mutex);
+			for (;;) {
+				condition.wait(lock, [&] { return queued > 0 || taken == producers * per_producer; });
+				if (queued == 0) {
+					break;
+				}
+				--queued, ++taken;
+				if (taken == producers * per_producer) {
+					// wake the other consumers so that they see that everything has been taken
+					condition.notify_all();
+				}
+			}
+		});
+	}
+	for (auto &thread : threads) {
+		thread.join();
+	}
+	assert(taken == producers * per_producer);
+}
+
+static void semaphore() {
+	linux::FutexSemaphore semaphore(2);
+	assert(semaphore.try_acquire() && semaphore.try_acquire() && !semaphore.try_acquire());
+	assert(!semaphore.try_acquire_for(10ms));
+	std::vector<std::thread> waiters;
+	for (int t = 0; t < 3; ++t) {
+		waiters.emplace_back([&] { semaphore.acquire(); });
+	}
+	std::this_thread::sleep_for(20ms);
+	semaphore.release(3);
+	for (auto &waiter : waiters) {
+		waiter.join();
+	}
+	assert(!semaphore.try_acquire());
+}
+
+static void event() {
+	linux::FutexEvent event;
+	assert(!event.is_set() && !event.try_wait_for(10ms));
+	std::vector<std::thread> waiters;
+	for (int t = 0; t < 3; ++t) {
+		waiters.emplace_back([&] { event.wait(); });
+	}
+	std::this_thread::sleep_for(20ms);
+	event.set();
+	for (auto &waiter : waiters) {
+		waiter.join();
+	}
+	assert(event.is_set() && event.try_wait_for(0ms));
+}
+
+static void group() {
+	linux::FutexGroup group;
+	int words[3] = { };
+	const linux::FutexWait waits[] = { { &words[0], 0 }, { &words[1], 0 }, { &words[2], 0 } };
+	bool threw = false;
+	try {
+		group.wait_any({ });
+	}
+	catch (const std::system_error &e) {
+		threw = e.code().value() == EINVAL;
+	}
+	assert(threw);
+
+	// a word that no longer holds its expected value is reported without sleeping
+	__atomic_store_n(&words[2], 1, __ATOMIC_RELAXED);
+	assert(group.wait_any(waits) == 2);
+	__atomic_store_n(&words[2], 0, __ATOMIC_RELAXED);
+
+	assert(group.wait_any(waits, std::chrono::steady_clock::now() + 10ms) == -1);
+
+	// a wake through the group on any one word wakes the waiter
+	std::thread waker([&] {
+		std::this_thread::sleep_for(20ms);
+		__atomic_store_n(&words[1], 1, __ATOMIC_RELEASE);
+		group.wake(&words[1], 1);
+	});
+	int woken;
+	auto deadline = std::chrono::steady_clock::now() + 5s;
+	while ((woken = group.wait_any(waits, deadline)) < 0 && std::chrono::steady_clock::now() < deadline);
+	waker.join();
+	assert(woken == 1);
+}
+
+int main() {
+	mutex();
+	condition();
+	unlocked_notify();
+	semaphore();
+	event();
+	group();
+	return 0;
+}
@@ -0,0 +1,129 @@
+// Compares the futex primitives from linux_sync.h with the pthread-based ones they stand in for when
+// SYNC_FUTEX is defined: a mutex contended by several threads, a condition variable and a semaphore
+// each passing a token back and forth between two threads, and a semaphore shared by several threads.
+
+#include "../linux_sync.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <semaphore.h>
+
+static constexpr unsigned thread_counts[] = { 1, 2, 4, 8 };
+static constexpr unsigned long iterations = 2000000, round_trips = 100000;
+
+class PosixSemaphore {
+
+private:
+	sem_t sem;
+
+public:
+	explicit PosixSemaphore(int count = 0) noexcept { ::sem_init(&sem, 0, static_cast<unsigned>(count)); }
+	~PosixSemaphore() { ::sem_destroy(&sem); }
+
+public:
+	void acquire() { while (::sem_wait(&sem) < 0); }
+	void release() { ::sem_post(&sem); }
+
+};
+
+template <typename F>
+static double time_ns(F &&f) {
+	auto start = std::chrono::steady_clock::now();
+	f();
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename F>
+static double time_threads(unsigned n, F &&f) {
+	return time_ns([&] {
+		std::vector<std::thread> threads;
+		for (unsigned i = 0; i < n; ++i) {
+			threads.emplace_back(f);
+		}
+		for (auto &thread : threads) {
+			thread.join();
+		}
+	});
+}
+
+template <typename Mutex>
+static void mutex_bench(const char *name) {
+	for (unsigned n : thread_counts) {
+		Mutex mutex;
+		unsigned long counter = 0;
+		double ns = time_threads(n, [&] {
+			for (unsigned long i = 0; i < iterations / n; ++i) {
+				std::lock_guard<Mutex> lock(mutex);
+				++counter;
+			}
+		});
+		std::printf("mutex %-13s %u threads: %6.1f ns/lock\n", name, n, ns / iterations);
+	}
+}
+
+template <typename Mutex, typename Condition>
+static void condition_bench(const char *name) {
+	Mutex mutex;
+	Condition condition;
+	unsigned long turn = 0;
+	auto player = [&](unsigned long parity) {
+		std::unique_lock<Mutex> lock(mutex);
+		while (turn < 2 * round_trips) {
+			condition.wait(lock, [&] { return turn % 2 == parity || turn >= 2 * round_trips; });
+			if (turn < 2 * round_trips) {
+				++turn;
+				condition.notify_one();
+			}
+		}
+	};
+	double ns = time_ns([&] {
+		std::thread other(player, 1);
+		player(0);
+		other.join();
+	});
+	std::printf("condition %-9s ping-pong: %6.1f ns/round trip\n", name, ns / round_trips);
+}
+
+template <typename Semaphore>
+static void semaphore_bench(const char *name) {
+	Semaphore ping, pong;
+	double ns = time_ns([&] {
+		std::thread other([&] {
+			for (unsigned long i = 0; i < round_trips; ++i) {
+				ping.acquire();
+				pong.release();
+			}
+		});
+		for (unsigned long i = 0; i < round_trips; ++i) {
+			ping.release();
+			pong.acquire();
+		}
+		other.join();
+	});
+	std::printf("semaphore %-9s ping-pong: %6.1f ns/round trip\n", name, ns / round_trips);
+	for (unsigned n : thread_counts) {
+		Semaphore slots(static_cast<int>((n + 1) / 2));
+		double ns = time_threads(n, [&] {
+			for (unsigned long i = 0; i < iterations / n; ++i) {
+				slots.acquire();
+				slots.release();
+			}
+		});
+		std::printf("semaphore %-9s %u threads: %6.1f ns/acquire\n", name, n, ns / iterations);
+	}
+}
+
+int main() {
+	mutex_bench<linux::FutexMutex>("futex");
+	mutex_bench<std::mutex>("pthread");
+	condition_bench<linux::FutexMutex, linux::FutexCondition>("futex");
+	condition_bench<std::mutex, std::condition_variable>("pthread");
+	semaphore_bench<linux::FutexSemaphore>("futex");
+	semaphore_bench<PosixSemaphore>("posix");
+	return 0;
+}
@@ -0,0 +1,72 @@
+#include "../timingwheel.h"
+
+#include <cassert>
+#include <random>
+#include <vector>
+
+struct Timer : TimingWheel::Entry {
+	TimingWheel::tick_t due, fired = TimingWheel::never;
+};
+
+static Timer & timer_of(TimingWheel::Entry &entry) {
+	return static_cast<Timer &>(entry);
+}
+
+int main() {
+	static constexpr TimingWheel::tick_t start = 1000;
+	TimingWheel wheel(start);
+	assert(wheel.next_tick() == TimingWheel::never);
+
+	// deadlines on either side of every level boundary, and a spread of others, so that they cascade
+	std::vector<TimingWheel::tick_t> deltas = { 0, 1, 63, 64, 65, 4095, 4096, 4097, 262143, 262144, 262145, 16777216 + 7 };
+	std::minstd_rand rand(1);
+	for (int i = 0; i < 1000; ++i) {
+		deltas.push_back(std::uniform_int_distribution<TimingWheel::tick_t>(0, 20000000)(rand));
+	}
+	std::vector<Timer> timers(deltas.size());
+	for (size_t i = 0; i < timers.size(); ++i) {
+		timers[i].due = start + deltas[i];
+		wheel.arm(timers[i], timers[i].due);
+		assert(timers[i].armed());
+	}
+
+	// advance one tick at a time across the first two levels, then in uneven strides
+	for (TimingWheel::tick_t now = start; now < start + 5000; ++now) {
+		wheel.advance(now, [now](TimingWheel::Entry &entry) {
+			assert(!entry.armed());
+			timer_of(entry).fired = now;
+		});
+	}
+	for (TimingWheel::tick_t now = start + 5000; wheel.next_tick() != TimingWheel::never; now += 997) {
+		wheel.advance(now, [now](TimingWheel::Entry &entry) {
+			timer_of(entry).fired = now;
+		});
+	}
+	for (auto &timer : timers) {
+		// fired at the first advance that reached its deadline: exactly on time while stepping by one tick
+		assert(timer.fired >= timer.due);
+		assert(timer.due < start + 5000 ? timer.fired == timer.due : timer.fired - timer.due < 997);
+	}
+
+	// next_tick never overshoots the earliest deadline
+	Timer a, b;
+	wheel.arm(a, wheel.now() + 300000);
+	wheel.arm(b, wheel.now() + 70);
+	assert(wheel.next_tick() <= b.deadline());
+	b.cancel();
+	assert(!b.armed() && wheel.next_tick() <= a.deadline());
+
+	// a callback may re-arm the entry it was passed
+	int runs = 0;
+	while (a.armed()) {
+		TimingWheel::tick_t due = a.deadline();
+		assert(wheel.advance(due - 1, [](TimingWheel::Entry &) { assert(false); }) == 0);
+		assert(wheel.advance(due, [&](TimingWheel::Entry &entry) {
+			if (++runs < 3) {
+				wheel.arm(entry, due + 4096);
+			}
+		}) == 1);
+	}
+	assert(runs == 3 && wheel.next_tick() == TimingWheel::never);
+	return 0;
+}
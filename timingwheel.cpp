@@ -0,0 +1,52 @@
+#include "timingwheel.h"
+
+
+TimingWheel::tick_t TimingWheel::next_tick() const noexcept {
+	tick_t next = never;
+	for (unsigned level = 0; level < levels; ++level) {
+		if (uint64_t bits = occupied[level]) {
+			unsigned shift = level_bits * level;
+			tick_t block = (current + ((tick_t(1) << shift) - 1)) >> shift;
+			block += std::countr_zero(std::rotr(bits, static_cast<int>(block & (slots - 1))));
+			next = std::min(next, block << shift);
+		}
+	}
+	return next;
+}
+
+void TimingWheel::insert(Entry &entry) noexcept {
+	if (entry.expires < current) {
+		entry.expires = current;
+	}
+	tick_t delta = entry.expires - current;
+	if (_unlikely(delta > max_delta)) {
+		entry.expires = current + (delta = max_delta);
+	}
+	unsigned level = static_cast<unsigned>(std::bit_width(delta | 1) - 1) / level_bits;
+	unsigned index = entry.expires >> level_bits * level & (slots - 1);
+	Entry *&head = buckets[level][index];
+	if ((entry.next = head)) {
+		head->pprev = &entry.next;
+	}
+	entry.pprev = &head, head = &entry;
+	occupied[level] |= uint64_t(1) << index;
+}
+
+void TimingWheel::detach(Entry *&head, unsigned level, unsigned index) noexcept {
+	Entry *&bucket = buckets[level][index];
+	if ((head = bucket)) {
+		head->pprev = &head;
+		bucket = nullptr;
+	}
+	occupied[level] &= ~(uint64_t(1) << index);
+}
+
+void TimingWheel::cascade(unsigned level, unsigned index) noexcept {
+	Entry *head;
+	this->detach(head, level, index);
+	while (head) {
+		Entry &entry = *head;
+		entry.cancel();
+		this->insert(entry);
+	}
+}
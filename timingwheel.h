@@ -0,0 +1,99 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+
+#include "bit.h"
+#include "compiler.h"
+
+
+// A hierarchical timing wheel in the style of the classic Linux kernel timer wheel:
+// levels of 64 slots each, where a slot at level L spans 64^L ticks. Arming and
+// cancelling are O(1); expiring timers are cascaded down one level at a time.
+// Not thread-safe.
+class TimingWheel {
+
+public:
+	typedef uint64_t tick_t;
+
+	static constexpr unsigned level_bits = 6, levels = 8, slots = 1u << level_bits;
+	static constexpr tick_t max_delta = (tick_t(1) << level_bits * levels) - 1;
+	static constexpr tick_t never = std::numeric_limits<tick_t>::max();
+
+	class Entry {
+		friend TimingWheel;
+	private:
+		Entry *next, **pprev;
+		tick_t expires;
+	public:
+		Entry() noexcept : next(), pprev(), expires() { }
+		~Entry() { this->cancel(); }
+	private:
+		Entry(const Entry &) = delete;
+		Entry & operator=(const Entry &) = delete;
+	public:
+		bool _pure armed() const noexcept { return pprev; }
+		tick_t _pure deadline() const noexcept { return expires; }
+		void cancel() noexcept {
+			if (pprev) {
+				if ((*pprev = next)) {
+					next->pprev = pprev;
+				}
+				pprev = nullptr;
+			}
+		}
+	};
+
+private:
+	tick_t current;
+	std::array<uint64_t, levels> occupied;
+	std::array<std::array<Entry *, slots>, levels> buckets;
+
+public:
+	explicit TimingWheel(tick_t now = 0) noexcept : current(now), occupied(), buckets() { }
+
+private:
+	TimingWheel(const TimingWheel &) = delete;
+	TimingWheel & operator=(const TimingWheel &) = delete;
+
+public:
+	// the next tick that advance() has yet to process
+	tick_t _pure now() const noexcept { return current; }
+
+	// (re)arms entry to expire at the given tick; a tick in the past expires at the next advance
+	void arm(Entry &entry, tick_t expires) noexcept { entry.cancel(), entry.expires = expires, this->insert(entry); }
+
+	// a lower bound on the tick at which advance() will next have work to do, or never if empty
+	tick_t _pure next_tick() const noexcept;
+
+	// expires all entries whose deadline is at or before now, passing each to fn after unarming it;
+	// fn may arm or cancel any entry, including the one it was passed
+	template <typename F>
+	size_t advance(tick_t now, F &&fn) {
+		size_t n = 0;
+		while (current <= now) {
+			for (unsigned level = 1; level < levels && (current >> level_bits * (level - 1) & (slots - 1)) == 0; ++level) {
+				this->cascade(level, current >> level_bits * level & (slots - 1));
+			}
+			Entry *head;
+			this->detach(head, 0, current & (slots - 1));
+			++current;
+			while (head) {
+				Entry &entry = *head;
+				entry.cancel();
+				fn(entry);
+				++n;
+			}
+			current = std::min(this->next_tick(), now + 1);
+		}
+		return n;
+	}
+
+private:
+	void insert(Entry &entry) noexcept;
+	void detach(Entry *&head, unsigned level, unsigned index) noexcept;
+	void cascade(unsigned level, unsigned index) noexcept;
+
+};
@@ -27,6 +27,20 @@ public:
 		}
 	}
 
+#if defined(__linux__) && defined(SELECTOR_IO_URING)
+	// epoll forgets the socket when it is closed, but an armed io_uring poll would keep it open
+	~Handshake() override {
+		// the socket is gone if the handshake completed and handed it over
+		if (socket) {
+			try {
+				selector.remove(socket);
+			}
+			catch (...) {
+			}
+		}
+	}
+#endif
+
 public:
 	void selected(Selector &selector, Selector::Flags flags) noexcept override {
 		if ((flags & Selector::Flags::READABLE) != Selector::Flags::NONE) {